@@ -0,0 +1,276 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "generator.h"
+
+#include "database.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/* independent random streams per package */
+enum
+{
+    STREAM_NAME,
+    STREAM_VERSION,
+    STREAM_DETAILS,
+    STREAM_DEPENDENCIES,
+    STREAM_FILES,
+};
+
+/* a maintainer looks after this many packages, on average */
+#define PACKAGES_PER_MAINTAINER 25
+
+static const char *WORDS[] =
+{
+    "lib", "gtk", "py", "x", "qt", "net", "ssl", "zip",
+    "font", "core", "util", "media", "sound", "image", "crypt", "xml",
+    "json", "http", "mail", "term", "data", "math", "perl", "ruby",
+    "tcl", "db", "video", "print", "scan", "gl", "vk", "sys",
+};
+#define WORD_COUNT (sizeof (WORDS) / sizeof (*WORDS))
+
+static const char *FIRST_NAMES[] =
+{
+    "Alex", "Sam", "Robin", "Kim", "Jo", "Lee", "Ari", "Noor",
+    "Sasha", "Yuki", "Remy", "Tal", "Iris", "Omar", "Vera", "Finn",
+};
+static const char *LAST_NAMES[] =
+{
+    "Moreno", "Okafor", "Lindqvist", "Tanaka", "Novak", "Haddad", "Walsh",
+    "Costa", "Ivanova", "Byrne", "Kowalski", "Mensah", "Dubois", "Singh",
+    "Keller", "Park",
+};
+#define NAME_COUNT (sizeof (FIRST_NAMES) / sizeof (*FIRST_NAMES))
+
+static const char *LOCALES[] = { "de", "fr", "es", "ja", "pt_BR", "zh_CN" };
+#define LOCALE_COUNT (sizeof (LOCALES) / sizeof (*LOCALES))
+
+
+static uint64_t mix (uint64_t x);
+static uint64_t next (uint64_t *state);
+static double uniform (uint64_t *state);
+
+
+static uint64_t
+mix (uint64_t x)
+{
+    /* the splitmix64 finalizer */
+    x = (x ^ (x >> 30)) * UINT64_C (0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * UINT64_C (0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+
+static uint64_t
+next (uint64_t *state)
+{
+    *state += UINT64_C (0x9E3779B97F4A7C15);
+    return mix (*state);
+}
+
+
+static double
+uniform (uint64_t *state)
+{
+    /* [0, 1) from the top 53 bits */
+    return (double)(next (state) >> 11) / (double)(UINT64_C (1) << 53);
+}
+
+
+uint64_t
+generator_random (uint64_t seed, uint64_t stream, uint64_t i)
+{
+    return mix (seed ^ mix (stream ^ mix (i)));
+}
+
+
+void
+generator_init (generator_t *gen, uint64_t seed, size_t package_count,
+                size_t files_per_package)
+{
+    memset (gen, 0, sizeof (*gen));
+    gen->seed              = seed;
+    gen->package_count     = package_count;
+    gen->files_per_package = files_per_package;
+}
+
+
+const char *
+generator_name (generator_t *gen, size_t i)
+{
+    /* two words and the index in base 36, so every name is unique and
+     * shares its words with many others, as in a real catalog */
+    uint64_t r = generator_random (gen->seed, STREAM_NAME, i);
+    char suffix[16];
+    char *iter = suffix + sizeof (suffix);
+    size_t n = i;
+
+    *(--iter) = '\0';
+    do
+    {
+        *(--iter) = "0123456789abcdefghijklmnopqrstuvwxyz"[n % 36];
+        n /= 36;
+    } while (0 != n);
+
+    snprintf (gen->name, sizeof (gen->name), "%s%s-%s",
+              WORDS[r % WORD_COUNT], WORDS[(r >> 8) % WORD_COUNT], iter);
+
+    return gen->name;
+}
+
+
+void
+generator_package (generator_t *gen, size_t i, db_package_t *package_out)
+{
+    uint64_t state = generator_random (gen->seed, STREAM_VERSION, i);
+    uint64_t r = next (&state);
+    size_t maintainer_count = (gen->package_count / PACKAGES_PER_MAINTAINER) + 1;
+    size_t maintainer = 0;
+
+    (void)generator_name (gen, i);
+
+    /* mostly small majors, a few pre-releases and letter releases */
+    switch (next (&state) % 10)
+    {
+    case 0:
+        snprintf (gen->version, sizeof (gen->version), "%u.%u.%urc%u",
+                  (unsigned)(r % 4), (unsigned)((r >> 8) % 30),
+                  (unsigned)((r >> 16) % 20), (unsigned)((r >> 24) % 4) + 1);
+        break;
+    case 1:
+        snprintf (gen->version, sizeof (gen->version), "%u.%u%c",
+                  (unsigned)(r % 4), (unsigned)((r >> 8) % 30),
+                  (char)('a' + ((r >> 16) % 6)));
+        break;
+    default:
+        snprintf (gen->version, sizeof (gen->version), "%u.%u.%u",
+                  (unsigned)(r % 4), (unsigned)((r >> 8) % 30),
+                  (unsigned)((r >> 16) % 20));
+        break;
+    }
+
+    state = generator_random (gen->seed, STREAM_DETAILS, i);
+    maintainer = (size_t)(next (&state) % maintainer_count);
+
+    snprintf (gen->homepage, sizeof (gen->homepage),
+              "https://www.example.org/projects/%s/", gen->name);
+    snprintf (gen->maintainer, sizeof (gen->maintainer), "%s %s %zu",
+              FIRST_NAMES[maintainer % NAME_COUNT],
+              LAST_NAMES[(maintainer / NAME_COUNT) % NAME_COUNT],
+              maintainer);
+    snprintf (gen->email, sizeof (gen->email), "maintainer%zu@example.org",
+              maintainer);
+
+    package_out->package_id    = 0;
+    package_out->valid         = PACKAGE_INVALID;
+    package_out->name          = gen->name;
+    package_out->version       = gen->version;
+    package_out->homepage      = gen->homepage;
+    package_out->maintainer    = gen->maintainer;
+    package_out->email         = gen->email;
+    package_out->as_dependency = (uniform (&state) < 0.4);
+    package_out->is_installed  = (uniform (&state) < 0.7);
+}
+
+
+size_t
+generator_dependencies (generator_t *gen, size_t i, size_t *deps_out)
+{
+    /* a geometric fan-out, about 2.3 on average, onto earlier packages
+     * only, so the graph has no cycles. cubing the draw favours the first
+     * packages, the way a few core libraries are needed by everything */
+    uint64_t state = generator_random (gen->seed, STREAM_DEPENDENCIES, i);
+    size_t count = 0, fanout = 0, dep = 0;
+    bool duplicate = false;
+    double u = 0.0;
+
+    while ((fanout < GENERATOR_FANOUT_MAX) && (uniform (&state) < 0.7))
+    {
+        fanout++;
+    }
+    if (fanout > i) fanout = i;
+
+    for (size_t n = 0; n < fanout; n++)
+    {
+        u = uniform (&state);
+        dep = (size_t)((double)i * u * u * u);
+
+        duplicate = false;
+        for (size_t k = 0; k < count; k++)
+        {
+            if (deps_out[k] == dep) duplicate = true;
+        }
+        if (!duplicate) deps_out[count++] = dep;
+    }
+
+    return count;
+}
+
+
+size_t
+generator_file_count (generator_t *gen, size_t i)
+{
+    /* uniform over 1 to twice the average, less one */
+    uint64_t r = generator_random (gen->seed, STREAM_FILES, i);
+
+    if (0 == gen->files_per_package) return 0;
+    return 1 + (size_t)(r % ((gen->files_per_package * 2) - 1));
+}
+
+
+const char *
+generator_file_path (generator_t *gen, size_t i, size_t k)
+{
+    /* the usual places a package installs to, two to six directories
+     * deep. the name and k keep every path unique */
+    uint64_t r = mix (generator_random (gen->seed, STREAM_FILES, i) ^ mix (k));
+    const char *name = generator_name (gen, i);
+    const char *word = WORDS[(r >> 8) % WORD_COUNT];
+    const char *word2 = WORDS[(r >> 16) % WORD_COUNT];
+
+    switch (r % 8)
+    {
+    case 0:
+        snprintf (gen->path, sizeof (gen->path), "/usr/bin/%s%zu", name, k);
+        break;
+    case 1:
+        snprintf (gen->path, sizeof (gen->path), "/usr/lib/lib%s.so.%zu",
+                  name, k);
+        break;
+    case 2:
+        snprintf (gen->path, sizeof (gen->path), "/usr/include/%s/%s%zu.h",
+                  name, word, k);
+        break;
+    case 3:
+        snprintf (gen->path, sizeof (gen->path),
+                  "/usr/share/doc/%s/%s%zu.txt", name, word, k);
+        break;
+    case 4:
+        snprintf (gen->path, sizeof (gen->path),
+                  "/usr/share/%s/%s/%s/%s%zu.dat", name, word, word2, word, k);
+        break;
+    case 5:
+        snprintf (gen->path, sizeof (gen->path), "/usr/lib/%s/%s/%s%zu.so",
+                  name, word, word2, k);
+        break;
+    case 6:
+        snprintf (gen->path, sizeof (gen->path), "/etc/%s/%s%zu.conf",
+                  name, word, k);
+        break;
+    default:
+        snprintf (gen->path, sizeof (gen->path),
+                  "/usr/share/locale/%s/LC_MESSAGES/%s%zu.mo",
+                  LOCALES[(r >> 24) % LOCALE_COUNT], name, k);
+        break;
+    }
+
+    return gen->path;
+}
+
+
+/* end of file */
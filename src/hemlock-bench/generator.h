@@ -0,0 +1,53 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_GENERATOR_HEADER
+#define HEMLOCK_GENERATOR_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include "database.h"
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* most packages any one package depends on */
+#define GENERATOR_FANOUT_MAX 16
+
+/* a synthetic package catalog. package i, its dependencies and its files
+ * depend only on the seed and i, so a query can regenerate any of them
+ * instead of the catalog being kept in memory. generated strings live in
+ * the generator, until the next call */
+typedef struct
+{
+    uint64_t seed;
+    size_t package_count;
+    size_t files_per_package;   /* on average */
+    char name[64];
+    char version[32];
+    char homepage[128];
+    char maintainer[64];
+    char email[64];
+    char path[256];
+} generator_t;
+
+
+void generator_init (generator_t *gen, uint64_t seed, size_t package_count,
+                     size_t files_per_package);
+uint64_t generator_random (uint64_t seed, uint64_t stream, uint64_t i);
+
+const char *generator_name (generator_t *gen, size_t i);
+void generator_package (generator_t *gen, size_t i, db_package_t *package_out);
+size_t generator_dependencies (generator_t *gen, size_t i, size_t *deps_out);
+size_t generator_file_count (generator_t *gen, size_t i);
+const char *generator_file_path (generator_t *gen, size_t i, size_t k);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
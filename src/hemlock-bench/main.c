@@ -0,0 +1,415 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "arguement.h"
+#include "config.h"
+#include "database.h"
+#include "database_core.h"
+#include "generator.h"
+#include "workload.h"
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define BENCH_NAME "hemlock-bench"
+#define BENCH_DATABASE_FILE "hemlock-bench.db"
+
+/* catalog sizes run when no --scale is given */
+static const size_t DEFAULT_SCALES[] = { 1000, 100000, 1000000 };
+#define DEFAULT_SCALE_COUNT (sizeof (DEFAULT_SCALES) / sizeof (*DEFAULT_SCALES))
+#define SCALE_MAX 16
+
+/* like queries scan the catalog, run fewer of them on large ones */
+#define LIKE_ROWS_PER_QUERY_STEP 10000
+
+typedef struct
+{
+    char *database;
+    char *profile;
+    size_t scales[SCALE_MAX];
+    size_t scale_count;
+    size_t files_per_package;
+    size_t queries;
+    uint64_t seed;
+    bool keep;
+    bool verbose;
+} bench_settings_t;
+
+
+static int get_args (bench_settings_t *settings, int argc, char **argv);
+static int parse_count (const char *str, size_t *count_out);
+static void log_bench_help (FILE *fp);
+static void remove_database (const char *database);
+static void log_result (FILE *fp, sqlite3 *db, size_t scale,
+                        workload_result_t *result);
+static int run_scale (bench_settings_t settings, size_t scale);
+
+
+int
+main (int argc, char **argv)
+{
+    int retcode = 0;
+    bench_settings_t settings =
+    {
+        .database          = BENCH_DATABASE_FILE,
+        .profile           = NULL,
+        .scale_count       = 0,
+        .files_per_package = 8,
+        .queries           = 1000,
+        .seed              = 1,
+        .keep              = false,
+        .verbose           = false,
+    };
+
+    retcode = get_args (&settings, argc - 1, argv + 1);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if (0 == settings.scale_count)
+    {
+        memcpy (settings.scales, DEFAULT_SCALES, sizeof (DEFAULT_SCALES));
+        settings.scale_count = DEFAULT_SCALE_COUNT;
+    }
+
+    if (0 != db_select_profile (settings.profile))
+    {
+        fprintf (stderr, "error: unknown profile '%s'\n", 
+                 (NULL != settings.profile) ? settings.profile 
+                                            : getenv ("HEMLOCK_PROFILE"));
+        return EXIT_FAILURE;
+    }
+
+    /* one JSON object per line: this header, then one per operation */
+    printf ("{\"benchmark\":\"" BENCH_NAME "\",\"version\":\"" PROJECT_VERSION
+            "\",\"sqlite\":\"%s\",\"profile\":\"%s\",\"seed\":%llu,"
+            "\"files_per_package\":%zu,\"queries\":%zu}\n",
+            sqlite3_libversion (),
+            db_profile_name (),
+            (unsigned long long)settings.seed, settings.files_per_package,
+            settings.queries);
+    fflush (stdout);
+
+    for (size_t i = 0; (i < settings.scale_count) && (0 == retcode); i++)
+    {
+        retcode = run_scale (settings, settings.scales[i]);
+    }
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static void
+remove_database (const char *database)
+{
+    /* the database and whichever journal its profile left behind */
+    const char *SUFFIXES[] = { "", "-journal", "-wal", "-shm" };
+    const size_t SUFFIX_COUNT = sizeof (SUFFIXES) / sizeof (*SUFFIXES);
+    char path[4096];
+
+    for (size_t i = 0; i < SUFFIX_COUNT; i++)
+    {
+        snprintf (path, sizeof (path), "%s%s", database, SUFFIXES[i]);
+        (void)remove (path);
+    }
+}
+
+
+static void
+log_result (FILE *fp, sqlite3 *db, size_t scale, workload_result_t *result)
+{
+    int page_count = 0, page_size = 0;
+    double rate = 0.0;
+
+    (void)db_pragma_integer (db, "page_count", &page_count);
+    (void)db_pragma_integer (db, "page_size", &page_size);
+
+    if (0.0 < result->seconds) rate = (double)result->count / result->seconds;
+
+    fprintf (fp, "{\"scale\":%zu,\"operation\":\"%s\",\"count\":%zu,"
+             "\"rows\":%zu,\"seconds\":%.6f,\"ops_per_second\":%.1f,"
+             "\"database_bytes\":%llu}\n",
+             scale, result->operation, result->count, result->rows,
+             result->seconds, rate,
+             (unsigned long long)page_count * (unsigned long long)page_size);
+    fflush (fp);
+}
+
+
+static int
+run_scale (bench_settings_t settings, size_t scale)
+{
+    int retcode = -1;
+    sqlite3 *db = NULL;
+    int *ids = NULL;
+    generator_t gen;
+    workload_result_t result;
+    size_t like_queries = 0;
+
+    generator_init (&gen, settings.seed, scale, settings.files_per_package);
+    like_queries = settings.queries / (1 + (scale / LIKE_ROWS_PER_QUERY_STEP));
+    if (0 == like_queries) like_queries = 1;
+
+    ids = calloc (scale, sizeof (int));
+    if (NULL == ids)
+    {
+        fprintf (stderr, "error: out of memory\n");
+        return -1;
+    }
+
+    remove_database (settings.database);
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n",
+                 settings.database);
+        goto run_scale_exit;
+    }
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        goto run_scale_exit;
+    }
+
+    if (settings.verbose) fprintf (stderr, "scale %zu: insert\n", scale);
+    if (0 != workload_insert (db, &gen, ids, &result)) goto run_scale_error;
+    log_result (stdout, db, scale, &result);
+
+    if (settings.verbose) fprintf (stderr, "scale %zu: search\n", scale);
+    if (0 != workload_search_match (db, &gen, settings.queries, &result))
+    {
+        goto run_scale_error;
+    }
+    log_result (stdout, db, scale, &result);
+
+    if (0 != workload_search_exact (db, &gen, settings.queries, &result))
+    {
+        goto run_scale_error;
+    }
+    log_result (stdout, db, scale, &result);
+
+    if (0 != workload_search_like (db, &gen, like_queries, &result))
+    {
+        goto run_scale_error;
+    }
+    log_result (stdout, db, scale, &result);
+
+    if (settings.verbose) fprintf (stderr, "scale %zu: update\n", scale);
+    if (0 != workload_update (db, &gen, ids, settings.queries, &result))
+    {
+        goto run_scale_error;
+    }
+    log_result (stdout, db, scale, &result);
+
+    if (settings.verbose) fprintf (stderr, "scale %zu: remove\n", scale);
+    if (0 != workload_remove (db, &gen, ids, settings.queries, &result))
+    {
+        goto run_scale_error;
+    }
+    log_result (stdout, db, scale, &result);
+
+    retcode = 0;
+    goto run_scale_exit;
+
+run_scale_error:
+    fprintf (stderr, "error: scale %zu: %s failed\n", scale,
+             result.operation);
+
+run_scale_exit:
+    db_close (db); db = NULL;
+    if (!settings.keep) remove_database (settings.database);
+    free (ids); ids = NULL;
+
+    return retcode;
+}
+
+
+static int
+parse_count (const char *str, size_t *count_out)
+{
+    /* a whole number, optionally suffixed k (thousand) or M (million) */
+    char *end = NULL;
+    unsigned long long count = 0;
+
+    if ((NULL == str) || ('\0' == *str) || ('-' == *str)) return -1;
+
+    count = strtoull (str, &end, 10);
+    if (end == str) return -1;
+    if (('k' == *end) || ('K' == *end)) { count *= 1000;    end++; }
+    else if ('M' == *end)               { count *= 1000000; end++; }
+    if ('\0' != *end) return -1;
+
+    *count_out = (size_t)count;
+    return 0;
+}
+
+
+static int
+get_args (bench_settings_t *settings, int argc, char **argv)
+{
+    /* returns 0 to run, 1 once help is shown, -1 on error */
+    enum
+    {
+        BENCH_SCALE = CONARG_ID_CUSTOM,
+        BENCH_FILES,
+        BENCH_QUERIES,
+        BENCH_SEED,
+        BENCH_DATABASE,
+        BENCH_PROFILE,
+        BENCH_KEEP,
+        BENCH_VERBOSE,
+        BENCH_HELP,
+    };
+
+    const conarg_t ARG_LIST[] =
+    {
+        { BENCH_SCALE,    "-s", "--scale",    CONARG_PARAM_REQUIRED },
+        { BENCH_FILES,    "-f", "--files",    CONARG_PARAM_REQUIRED },
+        { BENCH_QUERIES,  "-q", "--queries",  CONARG_PARAM_REQUIRED },
+        { BENCH_SEED,     NULL, "--seed",     CONARG_PARAM_REQUIRED },
+        { BENCH_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { BENCH_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
+        { BENCH_KEEP,     "-k", "--keep",     CONARG_PARAM_NONE },
+        { BENCH_VERBOSE,  "-v", "--verbose",  CONARG_PARAM_NONE },
+        { BENCH_HELP,     "-h", "--help",     CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+
+    int id;
+    conarg_status_t param_stat;
+    char *param = NULL;
+    size_t count = 0;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        /* every counted option takes the same kind of number */
+        if ((BENCH_SCALE == id) || (BENCH_FILES == id)
+         || (BENCH_QUERIES == id) || (BENCH_SEED == id))
+        {
+            CONARG_STEP (argc, argv);
+            param = conarg_get_param (argc, argv);
+            if ((0 != parse_count (param, &count))
+             || ((BENCH_SCALE == id) && (0 == count)))
+            {
+                fprintf (stderr, "error: invalid number '%s'\n", param);
+                log_bench_help (stderr);
+                return -1;
+            }
+        }
+
+        switch (id)
+        {
+        case BENCH_SCALE:
+            if (SCALE_MAX <= settings->scale_count)
+            {
+                fprintf (stderr, "error: at most %d scales\n", SCALE_MAX);
+                return -1;
+            }
+            settings->scales[settings->scale_count++] = count;
+            break;
+
+        case BENCH_FILES:
+            settings->files_per_package = count;
+            break;
+
+        case BENCH_QUERIES:
+            settings->queries = count;
+            break;
+
+        case BENCH_SEED:
+            settings->seed = (uint64_t)count;
+            break;
+
+        case BENCH_DATABASE:
+            CONARG_STEP (argc, argv);
+            settings->database = conarg_get_param (argc, argv);
+            break;
+
+        case BENCH_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case BENCH_KEEP:
+            settings->keep = true;
+            break;
+
+        case BENCH_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case BENCH_HELP:
+            log_bench_help (stdout);
+            return 1;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_bench_help (stderr);
+            return -1;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return 0;
+}
+
+
+static void
+log_bench_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " BENCH_NAME " [OPTION]...\n"
+        "Time the package database on generated catalogs.\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "  -s, --scale N               generate a catalog of N packages, may be given\n"
+        "                                more than once (default 1k, 100k and 1M)\n"
+        "  -f, --files N               log N files per package, on average (default 8)\n"
+        "  -q, --queries N             run N of each search, update and remove\n"
+        "                                (default 1000)\n"
+        "      --seed N                generate a different catalog (default 1)\n"
+        "      --database DBFILE       build the catalogs in DBFILE, it is replaced\n"
+        "                                (default " BENCH_DATABASE_FILE ")\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "  -k, --keep                  keep DBFILE after the last catalog\n"
+        "  -v, --verbose               log progress\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "N may end in k or M for thousands or millions.\n"
+        "\n"
+        "Each catalog is inserted, searched, updated and has packages removed,\n"
+        "through the same calls as hemlock-core. Every package depends on about\n"
+        "2.3 earlier ones, mostly the first few, and its files sit two to six\n"
+        "directories deep. The same seed always generates the same catalog.\n"
+        "\n"
+        "Results are written to standard output as one JSON object per line. The\n"
+        "first describes the run, each following one an operation at a scale:\n"
+        "  scale, operation, count, rows, seconds, ops_per_second, database_bytes\n"
+        "Operations are insert, search_match, search_exact, search_like, update\n"
+        "and remove. Inserts commit every 10000 packages, updates and removes\n"
+        "commit one at a time, like separate commands. Like searches scan the\n"
+        "catalog, fewer are run on larger ones.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, "%s", HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
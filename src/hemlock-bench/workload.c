@@ -0,0 +1,298 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "workload.h"
+
+#include "database.h"
+#include "database_core.h"
+#include "generator.h"
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/* packages per transaction while inserting, as a large import would */
+#define INSERT_BATCH 10000
+
+/* random streams for picking catalog entries, apart from the generator's */
+enum
+{
+    STREAM_SEARCH_MATCH = 16,
+    STREAM_SEARCH_EXACT,
+    STREAM_SEARCH_LIKE,
+    STREAM_UPDATE,
+    STREAM_REMOVE,
+};
+
+
+static double now (void);
+static size_t pick (generator_t *gen, uint64_t stream, size_t n);
+static void result_begin (workload_result_t *result, const char *operation);
+static int read_cursor (db_package_cursor_t *cursor, size_t *rows);
+
+
+static double
+now (void)
+{
+    struct timespec ts;
+
+    (void)timespec_get (&ts, TIME_UTC);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+
+static size_t
+pick (generator_t *gen, uint64_t stream, size_t n)
+{
+    return (size_t)(generator_random (gen->seed, stream, n)
+                    % gen->package_count);
+}
+
+
+static void
+result_begin (workload_result_t *result, const char *operation)
+{
+    result->operation = operation;
+    result->count     = 0;
+    result->rows      = 0;
+    result->seconds   = now ();
+}
+
+
+static int
+read_cursor (db_package_cursor_t *cursor, size_t *rows)
+{
+    /* drains the cursor the way search prints every match */
+    db_package_t package;
+    int retcode;
+
+    while (1 == (retcode = db_package_cursor_next (cursor, &package)))
+    {
+        (*rows)++;
+    }
+    db_package_cursor_close (cursor);
+
+    return ((0 > retcode) ? -1 : 0);
+}
+
+
+int
+workload_insert (sqlite3 *db, generator_t *gen, int *ids,
+                 workload_result_t *result_out)
+{
+    int retcode = 0;
+    bool in_transaction = false;
+    db_package_t package;
+    size_t deps[GENERATOR_FANOUT_MAX];
+    size_t dep_count = 0, file_count = 0;
+    const char *path = NULL;
+
+    result_begin (result_out, "insert");
+
+    for (size_t i = 0; (i < gen->package_count) && (0 == retcode); i++)
+    {
+        if (!in_transaction)
+        {
+            if (0 != db_transaction_begin (db, NULL)) return -1;
+            in_transaction = true;
+        }
+
+        generator_package (gen, i, &package);
+        if (0 != db_insert_package (db, &package, NULL))
+        {
+            retcode = -1;
+            break;
+        }
+        ids[i] = package.package_id;
+        result_out->rows++;
+
+        dep_count = generator_dependencies (gen, i, deps);
+        for (size_t k = 0; (k < dep_count) && (0 == retcode); k++)
+        {
+            retcode = db_insert_dependency (db, ids[i], ids[deps[k]], NULL);
+            result_out->rows++;
+        }
+
+        file_count = generator_file_count (gen, i);
+        for (size_t k = 0; (k < file_count) && (0 == retcode); k++)
+        {
+            path = generator_file_path (gen, i, k);
+            retcode = db_insert_filelog (db, ids[i], path, NULL);
+            result_out->rows++;
+        }
+
+        result_out->count++;
+        if ((0 == retcode) && (0 == (result_out->count % INSERT_BATCH)))
+        {
+            retcode = db_transaction_commit (db, NULL);
+            in_transaction = false;
+        }
+    }
+
+    if (in_transaction)
+    {
+        if (0 == retcode) retcode = db_transaction_commit (db, NULL);
+        else (void)db_transaction_rollback (db, NULL);
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return retcode;
+}
+
+
+int
+workload_search_match (sqlite3 *db, generator_t *gen, size_t count,
+                       workload_result_t *result_out)
+{
+    /* full text search for a package's name, as 'search NAME' */
+    db_package_cursor_t cursor;
+    const char *name = NULL;
+
+    result_begin (result_out, "search_match");
+
+    for (size_t n = 0; n < count; n++)
+    {
+        name = generator_name (gen, pick (gen, STREAM_SEARCH_MATCH, n));
+        if ((0 != db_package_cursor_open_match (&cursor, db, name,
+                                                PACKAGE_FILTER_NONE, NULL))
+         || (0 != read_cursor (&cursor, &result_out->rows)))
+        {
+            return -1;
+        }
+        result_out->count++;
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return 0;
+}
+
+
+int
+workload_search_exact (sqlite3 *db, generator_t *gen, size_t count,
+                       workload_result_t *result_out)
+{
+    /* name and version lookups, as the insert duplicate check */
+    db_package_t package;
+    int package_id = 0;
+
+    result_begin (result_out, "search_exact");
+
+    for (size_t n = 0; n < count; n++)
+    {
+        generator_package (gen, pick (gen, STREAM_SEARCH_EXACT, n), &package);
+        if (0 != db_find_package (db, package.name, package.version,
+                                  &package_id, NULL))
+        {
+            return -1;
+        }
+        result_out->count++;
+        result_out->rows++;
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return 0;
+}
+
+
+int
+workload_search_like (sqlite3 *db, generator_t *gen, size_t count,
+                      workload_result_t *result_out)
+{
+    /* name prefix patterns, as 'search -l PREFIX%'. like cannot use an
+     * index, every query scans the catalog */
+    db_package_cursor_t cursor;
+    char pattern[8];
+    const char *name = NULL;
+
+    result_begin (result_out, "search_like");
+
+    for (size_t n = 0; n < count; n++)
+    {
+        name = generator_name (gen, pick (gen, STREAM_SEARCH_LIKE, n));
+        snprintf (pattern, sizeof (pattern), "%.5s%%", name);
+        if ((0 != db_package_cursor_open (&cursor, db, pattern, NULL,
+                                          PACKAGE_FILTER_NONE, NULL))
+         || (0 != read_cursor (&cursor, &result_out->rows)))
+        {
+            return -1;
+        }
+        result_out->count++;
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return 0;
+}
+
+
+int
+workload_update (sqlite3 *db, generator_t *gen, const int *ids,
+                 size_t count, workload_result_t *result_out)
+{
+    /* one homepage change per transaction, as 'update NAME VERSION -p' */
+    int retcode = 0;
+    db_package_t package;
+    size_t i = 0;
+
+    result_begin (result_out, "update");
+
+    for (size_t n = 0; (n < count) && (0 == retcode); n++)
+    {
+        i = pick (gen, STREAM_UPDATE, n);
+        generator_package (gen, i, &package);
+        snprintf (gen->homepage, sizeof (gen->homepage),
+                  "https://www.example.org/projects/%s/v%zu/", package.name, n);
+        package.package_id = ids[i];
+        package.valid = PACKAGE_VALID_PACKAGE_ID | PACKAGE_VALID_HOMEPAGE;
+
+        if (0 != db_transaction_begin (db, NULL)) return -1;
+        retcode = db_update_package (db, &package, NULL);
+        if (0 == retcode) retcode = db_transaction_commit (db, NULL);
+        else (void)db_transaction_rollback (db, NULL);
+
+        result_out->count++;
+        result_out->rows++;
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return retcode;
+}
+
+
+int
+workload_remove (sqlite3 *db, generator_t *gen, int *ids, size_t count,
+                 workload_result_t *result_out)
+{
+    /* one forced removal per transaction, as 'remove NAME VERSION -f'.
+     * removed entries are zeroed in ids, so none is removed twice */
+    int retcode = 0;
+    size_t i = 0, removed = 0;
+
+    result_begin (result_out, "remove");
+    if (count > gen->package_count) count = gen->package_count;
+
+    for (size_t n = 0; (n < count) && (0 == retcode); n++)
+    {
+        i = pick (gen, STREAM_REMOVE, n);
+        while (0 == ids[i]) i = (i + 1) % gen->package_count;
+
+        if (0 != db_transaction_begin (db, NULL)) return -1;
+        retcode = db_remove_package (db, ids[i], false, true, &removed, NULL);
+        if (0 == retcode) retcode = db_transaction_commit (db, NULL);
+        else (void)db_transaction_rollback (db, NULL);
+
+        ids[i] = 0;
+        result_out->count++;
+        result_out->rows += removed;
+    }
+
+    result_out->seconds = now () - result_out->seconds;
+    return retcode;
+}
+
+
+/* end of file */
@@ -0,0 +1,48 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_WORKLOAD_HEADER
+#define HEMLOCK_WORKLOAD_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include "generator.h"
+#include <sqlite3.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* one timed operation over a catalog */
+typedef struct
+{
+    const char *operation;
+    size_t count;       /* operations run */
+    size_t rows;        /* rows written or read by them */
+    double seconds;
+} workload_result_t;
+
+
+/* inserts the whole catalog, and the package id of catalog entry i into
+ * ids[i]. the rest run count operations on random catalog entries */
+int workload_insert (sqlite3 *db, generator_t *gen, int *ids, 
+                     workload_result_t *result_out);
+int workload_search_match (sqlite3 *db, generator_t *gen, size_t count,
+                           workload_result_t *result_out);
+int workload_search_exact (sqlite3 *db, generator_t *gen, size_t count,
+                           workload_result_t *result_out);
+int workload_search_like (sqlite3 *db, generator_t *gen, size_t count,
+                          workload_result_t *result_out);
+int workload_update (sqlite3 *db, generator_t *gen, const int *ids, 
+                     size_t count, workload_result_t *result_out);
+int workload_remove (sqlite3 *db, generator_t *gen, int *ids, size_t count,
+                     workload_result_t *result_out);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
@@ -0,0 +1,139 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "arena.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* default block size, larger requests get a block of their own */
+#define ARENA_BLOCK_SIZE ((size_t)64 * 1024)
+
+#define ARENA_ALIGN (_Alignof (max_align_t))
+#define ARENA_ROUND_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+
+struct arena_block
+{
+    arena_block_t *next;
+    size_t used;
+    size_t size;
+    _Alignas (max_align_t) unsigned char data[];
+};
+
+
+static arena_block_t *arena_block_new (size_t size);
+
+
+static arena_block_t *
+arena_block_new (size_t size)
+{
+    arena_block_t *block = malloc (sizeof (arena_block_t) + size);
+    if (NULL == block)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->used = 0;
+    block->size = size;
+
+    return block;
+}
+
+
+void
+arena_init (arena_t *arena)
+{
+    if (NULL == arena) return;
+
+    arena->head = NULL;
+    return;
+}
+
+
+void
+arena_free (arena_t *arena)
+{
+    arena_block_t *next = NULL;
+
+    if (NULL == arena) return;
+
+    /* one free per block, regardless of how many allocations it holds */
+    for (arena_block_t *iter = arena->head; NULL != iter; iter = next)
+    {
+        next = iter->next;
+        free (iter);
+    }
+    arena->head = NULL;
+
+    return;
+}
+
+
+void *
+arena_alloc (arena_t *arena, size_t size)
+{
+    arena_block_t *block = NULL;
+    void *result = NULL;
+
+    if ((NULL == arena) || (0 == size))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size = ARENA_ROUND_UP (size);
+    block = arena->head;
+
+    /* bump allocate from the current block when it has room */
+    if ((NULL != block) && (size <= (block->size - block->used)))
+    {
+        result = block->data + block->used;
+        block->used += size;
+        return result;
+    }
+
+    block = arena_block_new (size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+    if (NULL == block) return NULL;
+    block->used = size;
+
+    /* oversized blocks are full from the start, keep the current block at 
+     * the head so its remaining space is still used */
+    if ((size >= ARENA_BLOCK_SIZE) && (NULL != arena->head))
+    {
+        block->next = arena->head->next;
+        arena->head->next = block;
+    }
+    else
+    {
+        block->next = arena->head;
+        arena->head = block;
+    }
+
+    return block->data;
+}
+
+
+char *
+arena_string_clone (arena_t *arena, const char *src)
+{
+    char *dest = NULL;
+    size_t n = 0;
+
+    if (NULL == src) return NULL;
+
+    n = strlen (src) + 1;
+    dest = arena_alloc (arena, n);
+    if (NULL == dest) return NULL;
+
+    (void)memcpy (dest, src, n);
+    return dest;
+}
+
+
+/* end of file */
@@ -0,0 +1,36 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_ARENA_HEADER
+#define HEMLOCK_ARENA_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <stddef.h>
+
+
+/* a region allocator, everything allocated from an arena is released 
+ * together by arena_free () */
+typedef struct arena_block arena_block_t;
+
+typedef struct
+{
+    arena_block_t *head;
+} arena_t;
+
+
+void arena_init (arena_t *arena);
+void arena_free (arena_t *arena);
+void *arena_alloc (arena_t *arena, size_t size);
+char *arena_string_clone (arena_t *arena, const char *src);
+
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
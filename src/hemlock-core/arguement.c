@@ -23,7 +23,8 @@ conarg_is_flag (char *arg)
         return false;
     }
 
-    if ('-' == arg[0]) return true;
+    /* a lone "-" is a parameter, naming standard input/output */
+    if (('-' == arg[0]) && ('\0' != arg[1])) return true;
 
     return false;
 }
@@ -0,0 +1,426 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "batch.h"
+
+#include "arguement.h"
+#include "config.h"
+#include "database.h"
+#include "database_core.h"
+#include "mode.h"
+#include "mode_template.h"
+#include "settings.h"
+#include "string_utils.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int get_sequenced_args (settings_t *settings, int argc, char **argv);
+static int get_field_args (settings_t *settings, int argc, char **argv);
+static void log_batch_help (FILE *fp);
+static int run_command (char *line, size_t line_number);
+static int run_batch (settings_t settings);
+
+
+int
+batch_wrapper (int argc, char **argv)
+{
+    int retcode = 0;
+    settings_t settings;
+
+    retcode = mode_template_proccess_args (&settings, argc, argv,
+            REQUIRE_NONE, get_sequenced_args, get_field_args,
+            log_batch_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    retcode = run_batch (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static int
+run_command (char *line, size_t line_number)
+{
+    /* runs one line as if it followed the program name on a command line.
+     * returns 0 on success, 1 for a line with no command, -1 on failure */
+    int status = EXIT_FAILURE;
+    char **words = NULL;
+    char **command = NULL;
+    size_t word_count = 0;
+
+    words = string_split_words (line, &word_count);
+    if (NULL == words)
+    {
+        fprintf (stderr, "error: line %zu: unbalanced quote\n", line_number);
+        return -1;
+    }
+    if (0 == word_count)    /* blank or comment */
+    {
+        free (words);
+        return 1;
+    }
+
+    command = malloc ((word_count + 2) * sizeof (char *));
+    if (NULL == command)
+    {
+        free (words);
+        return -1;
+    }
+    command[0] = PROJECT_NAME;
+    memcpy (command + 1, words, (word_count + 1) * sizeof (char *));
+
+    if (!mode_is_forwardable ((int)word_count + 1, command))
+    {
+        fprintf (stderr, "error: line %zu: '%s' cannot run in a batch\n",
+                 line_number, command[1]);
+    }
+    else
+    {
+        status = mode_run ((int)word_count + 1, command);
+        if (EXIT_SUCCESS != status)
+        {
+            fprintf (stderr, "error: line %zu: command failed\n",
+                     line_number);
+        }
+    }
+
+    free (command); command = NULL;
+    free (words);   words = NULL;
+
+    return ((EXIT_SUCCESS == status) ? 0 : -1);
+}
+
+
+static int
+run_batch (settings_t settings)
+{
+    int retcode = -1;
+    int status = 0;
+    FILE *fp = NULL;
+    sqlite3 *db = NULL;
+    char *line = NULL;
+    size_t line_alloc = 0, line_number = 0;
+    size_t run_count = 0, fail_count = 0;
+    char *previous_database = NULL;
+    char *previous_profile = NULL;
+
+    if ((NULL == settings.from_file) || (0 == strcmp (settings.from_file, "-")))
+    {
+        fp = stdin;
+    }
+    else
+    {
+        fp = fopen (settings.from_file, "r");
+        if (NULL == fp)
+        {
+            fprintf (stderr, "error: cannot open command file '%s'\n",
+                     settings.from_file);
+            return -1;
+        }
+    }
+
+    /* the commands open the batch's database by default, with the batch's
+     * profile, and are handed this same connection. each of their
+     * transactions becomes a savepoint inside the batch's transaction */
+    previous_database = settings_default_database (settings.database);
+    previous_profile  = settings_default_profile (settings.profile);
+    db_retain_connections (true);
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n",
+                 settings.database);
+        goto run_batch_exit;
+    }
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        goto run_batch_exit;
+    }
+
+    if (settings.dry_run)
+    {
+        fprintf (stderr, "dry run detected\n");
+    }
+
+    if (0 != db_transaction_begin (db, NULL))
+    {
+        fprintf (stderr, "error: cannot begin transaction\n");
+        goto run_batch_exit;
+    }
+
+    retcode = 0;
+    while (NULL != string_read_line (fp, '\n', &line, &line_alloc))
+    {
+        line_number++;
+
+        /* a failed command undoes only its own work */
+        status = run_command (line, line_number);
+        if (1 == status) continue;
+
+        run_count++;
+        if (0 != status)
+        {
+            fail_count++;
+            if (!settings.keep_going)
+            {
+                retcode = -1;
+                break;
+            }
+        }
+
+        if ((0 < settings.commit_every) && (!settings.dry_run)
+         && (0 == (run_count % settings.commit_every)))
+        {
+            if ((0 != db_transaction_commit (db, NULL))
+             || (0 != db_transaction_begin (db, NULL)))
+            {
+                fprintf (stderr, "error: cannot commit at line %zu\n",
+                         line_number);
+                retcode = -1;
+                break;
+            }
+        }
+    }
+
+    if ((0 == retcode) && (ferror (fp)))
+    {
+        fprintf (stderr, "error: cannot read the command list\n");
+        retcode = -1;
+    }
+
+    /* a stopped batch drops everything since the last commit */
+    if ((0 == retcode) && (!settings.dry_run))
+    {
+        retcode = db_transaction_commit (db, NULL);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, NULL);
+    }
+
+    if (settings.verbose)
+    {
+        fprintf (stderr, "%zu command(s) run, %zu failed\n", run_count,
+                 fail_count);
+    }
+    if ((0 == retcode) && (0 < fail_count)) retcode = -1;
+
+run_batch_exit:
+    db_close (db); db = NULL;
+    db_retain_connections (false);
+    (void)settings_default_database (previous_database);
+    (void)settings_default_profile (previous_profile);
+    free (line); line = NULL;
+    if (stdin != fp) fclose (fp);
+
+    return retcode;
+}
+
+
+static int
+get_sequenced_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+    char *file = NULL;
+
+    /* batch [FILE] */
+
+    /* file (optional) */
+    file = conarg_get_param (argc, argv);
+    if ((NULL == file) || (conarg_is_flag (file)))
+    {
+        file = NULL;
+        goto sequence_exit;
+    }
+    CONARG_STEP (argc, argv);
+
+sequence_exit:
+    settings->from_file = file;
+
+    return (initial_count - argc);
+}
+
+
+static int
+get_field_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+
+    enum
+    {
+        BATCH_COMMIT_EVERY = CONARG_ID_CUSTOM,
+        BATCH_KEEP_GOING,
+        BATCH_DRY,
+        BATCH_DATABASE,
+        BATCH_PROFILE,
+        BATCH_DEBUG,
+        BATCH_STATS,
+        BATCH_TRACE,
+        BATCH_SLOW_QUERY,
+        BATCH_VERBOSE,
+        BATCH_TERSE,
+        BATCH_HELP,
+    };
+
+    const conarg_t ARG_LIST[] =
+    {
+        { BATCH_COMMIT_EVERY, "-c", "--commit-every", CONARG_PARAM_REQUIRED },
+        { BATCH_KEEP_GOING,   "-k", "--keep-going",   CONARG_PARAM_NONE },
+
+        { BATCH_DRY,      NULL, "--dryrun",   CONARG_PARAM_NONE },
+        { BATCH_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { BATCH_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
+
+        { BATCH_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { BATCH_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { BATCH_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { BATCH_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
+        { BATCH_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { BATCH_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { BATCH_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+
+    int id;
+    conarg_status_t param_stat;
+    char *interval = NULL, *end = NULL;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        switch (id)
+        {
+        case BATCH_COMMIT_EVERY:
+            CONARG_STEP (argc, argv);
+            interval = conarg_get_param (argc, argv);
+            settings->commit_every = strtoul (interval, &end, 10);
+            if (('\0' == *interval) || ('\0' != *end) || ('-' == *interval))
+            {
+                fprintf (stderr, "error: invalid commit interval '%s'\n",
+                         interval);
+                log_batch_help (stderr);
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case BATCH_KEEP_GOING:
+            settings->keep_going = true;
+            break;
+
+        case BATCH_DATABASE:
+            CONARG_STEP (argc, argv);
+            settings->database = conarg_get_param (argc, argv);
+            break;
+
+        case BATCH_DRY:
+            settings->dry_run = true;
+            break;
+
+        case BATCH_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case BATCH_STATS:
+            settings->stats = true;
+            break;
+
+        case BATCH_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case BATCH_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings, 
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case BATCH_DEBUG:
+            settings->debug   = true;
+            /* enable all verbose flags too */
+            /* fall through */
+        case BATCH_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case BATCH_TERSE:
+            settings->verbose = false;
+            break;
+
+        case BATCH_HELP:
+            log_batch_help (stdout);
+            return MODE_ARGS_HELP;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_batch_help (stderr);
+            return MODE_ARGS_ERROR;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static void
+log_batch_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " PROJECT_NAME " batch [FILE] [OPTION]...\n"
+        "Run many commands, one per line, in a single process and transaction.\n"
+        "Egless otherwise specified assume -t flag,\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "  -c, --commit-every N        commit after every N commands, instead of\n"
+        "                              once at the end\n"
+        "  -k, --keep-going            keep running after a command fails\n"
+        "      --database DBFILE       override the package database file, use DBFILE\n"
+        "      --dryrun                preform a dry-run. dont preform any writes\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
+        "  -v, --verbose               log extra information\n"
+        "  -t, --terse                 only log errors\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "Commands are read from FILE, or standard input when FILE is '-' or missing.\n"
+        "Each line is a mode and its arguements, as they would follow '" PROJECT_NAME "'\n"
+        "on the command line, for example 'insert zlib 1.3 -d'. Quotes and\n"
+        "backslashes work as in a shell, and lines starting with # are ignored.\n"
+        "\n"
+        "DBFILE is also the default database of every command. Commands on DBFILE\n"
+        "share one connection and one transaction, a failed command only undoes its\n"
+        "own changes. Without -k the first failure stops the batch and drops\n"
+        "everything since the last commit.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
@@ -0,0 +1,19 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_BATCH_HEADER
+#define HEMLOCK_BATCH_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+int batch_wrapper (int remaining, char **arg_iter);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
@@ -4,113 +4,551 @@
 
 #include "database.h"
 
+#include "arena.h"
+#include "config.h"
 #include "database_core.h"
+#include "filepath.h"
+#include <ctype.h>
+#include <errno.h>
 #include <sqlite3.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "stats.h"
 #include "string_utils.h"
 
 
-static char *gen_package_values (db_package_t *package);
-static char *gen_package_sets (db_package_t *package);
-static db_package_t *select_packages (sqlite3 *db, char *sql_statement, 
-                                      size_t max_n, size_t *n_out, FILE *log);
-
-
-static char *
-gen_package_values (db_package_t *package)
+/* statement cache slots, see db_prepare_cached () */
+enum
 {
-    char *result = NULL;
-    char *escaped_list[] = {
-        db_escape_null (),
-        db_escape_text (package->name),
-        db_escape_text (package->version),
-        db_escape_text (package->homepage),
-        db_escape_text (package->maintainer),
-        db_escape_text (package->email),
-        db_escape_boolean (package->as_dependency),
-        db_escape_boolean (package->is_installed)
-    };
-    const size_t LIST_COUNT = sizeof (escaped_list) / sizeof (*escaped_list);
+    STMT_INTERN_MAINTAINER,
+    STMT_RELEASE_MAINTAINER,
+    STMT_INSERT_PACKAGE,
+    STMT_UPSERT_PACKAGE,
+    STMT_SEARCH_PACKAGES,       /* one slot per db_package_filter_t */
+    STMT_SEARCH_PACKAGES_LATEST,
+    STMT_SEARCH_PACKAGES_UPGRADABLE,
+    STMT_SEARCH_PACKAGE_ID,
+    STMT_SEARCH_MATCH,          /* one slot per db_package_filter_t */
+    STMT_SEARCH_MATCH_LATEST,
+    STMT_SEARCH_MATCH_UPGRADABLE,
+    STMT_FIND_DIRECTORY,
+    STMT_INSERT_DIRECTORY,
+    STMT_INSERT_FILELOG,
+    STMT_INSERT_DEPENDENCY,
+    STMT_RESOLVE_PACKAGE,
+    STMT_FIND_PACKAGE,
+    STMT_REMOVE_SEED,
+    STMT_REMOVE_CASCADE,
+    STMT_REMOVE_PRUNE,
+    STMT_REMOVE_BLOCKING,
+    STMT_REMOVE_FILELOGS,
+    STMT_REMOVE_DEPENDENCIES,
+    STMT_REMOVE_PACKAGES,
+    STMT_CLEAR_FILELOGS,
+    STMT_CLEAR_REQUIREMENTS,
+    STMT_STAGE_OWNER_PATHS,
+    STMT_SEARCH_FILE_OWNER,
+    STMT_COUNT
+};
+_Static_assert (STMT_COUNT <= DB_STMT_CACHE_SIZE, 
+                "DB_STMT_CACHE_SIZE is too small for every statement");
+_Static_assert ((STMT_SEARCH_PACKAGES + PACKAGE_FILTER_UPGRADABLE 
+                    == STMT_SEARCH_PACKAGES_UPGRADABLE)
+             && (STMT_SEARCH_MATCH + PACKAGE_FILTER_UPGRADABLE 
+                    == STMT_SEARCH_MATCH_UPGRADABLE),
+                "search statement slots must follow db_package_filter_t");
+
+
+/* schema migrations, SCHEMA_MIGRATIONS[i] upgrades a database from
+ * user_version i to user_version i + 1. never edit an applied migration,
+ * append a new one instead */
+static const char *SCHEMA_MIGRATIONS[] = 
+{
+    /* 0 -> 1: base tables */
+    "CREATE TABLE IF NOT EXISTS packages (\n"
+    "    package_id INTEGER PRIMARY KEY,\n"
+    "    name TEXT NOT NULL,\n"
+    "    version TEXT NOT NULL,\n"
+    "    homepage TEXT,\n"
+    "    maintainer TEXT,\n"
+    "    email TEXT,\n"
+    "    as_dependency BOOLEAN,\n"
+    "    is_installed BOOLEAN\n"
+    ");\n"
+    "CREATE TABLE IF NOT EXISTS dependencies (\n"
+    "    dependency_id INTEGER PRIMARY KEY,\n"
+    "    dependant_id INTEGER NOT NULL,\n"
+    "    package_id INTEGER NOT NULL,\n"
+    "    FOREIGN KEY(dependant_id) REFERENCES packages(package_id),\n"
+    "    FOREIGN KEY(package_id)   REFERENCES packages(package_id)\n"
+    ");\n"
+    "CREATE TABLE IF NOT EXISTS filelogs (\n"
+    "    filelog_id INTEGER PRIMARY KEY,\n"
+    "    path TEXT NOT NULL,\n"
+    "    package_id INTEGER NOT NULL,\n"
+    "    FOREIGN KEY(package_id) REFERENCES package(package_id)\n"
+    ");\n",
+
+    /* 1 -> 2: lookup indexes */
+    "CREATE INDEX IF NOT EXISTS packages_name_version\n"
+    "    ON packages(name, version);\n"
+    "CREATE INDEX IF NOT EXISTS dependencies_dependant_id\n"
+    "    ON dependencies(dependant_id);\n"
+    "CREATE INDEX IF NOT EXISTS dependencies_package_id\n"
+    "    ON dependencies(package_id);\n"
+    "CREATE INDEX IF NOT EXISTS filelogs_path\n"
+    "    ON filelogs(path);\n"
+    "CREATE INDEX IF NOT EXISTS filelogs_package_id\n"
+    "    ON filelogs(package_id);\n",
+
+    /* 2 -> 3: full text index over packages, kept in sync by triggers */
+    "CREATE VIRTUAL TABLE IF NOT EXISTS packages_fts USING fts5 (\n"
+    "    name, homepage, maintainer,\n"
+    "    content='packages', content_rowid='package_id',\n"
+    "    prefix='2 3'\n"
+    ");\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_insert\n"
+    "AFTER INSERT ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (rowid, name, homepage, maintainer)\n"
+    "    VALUES (new.package_id, new.name, new.homepage, new.maintainer);\n"
+    "END;\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_delete\n"
+    "AFTER DELETE ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (packages_fts, rowid, name, homepage,\n"
+    "                              maintainer)\n"
+    "    VALUES ('delete', old.package_id, old.name, old.homepage,\n"
+    "            old.maintainer);\n"
+    "END;\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_update\n"
+    "AFTER UPDATE OF name, homepage, maintainer ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (packages_fts, rowid, name, homepage,\n"
+    "                              maintainer)\n"
+    "    VALUES ('delete', old.package_id, old.name, old.homepage,\n"
+    "            old.maintainer);\n"
+    "    INSERT INTO packages_fts (rowid, name, homepage, maintainer)\n"
+    "    VALUES (new.package_id, new.name, new.homepage, new.maintainer);\n"
+    "END;\n"
+    "INSERT INTO packages_fts (packages_fts) VALUES ('rebuild');\n",
+
+    /* 3 -> 4: one row per name and version. duplicates fold into the
+     * oldest row, which takes over their files and dependency edges, each
+     * kept once */
+    "CREATE TEMP TABLE package_duplicates AS\n"
+    "SELECT p.package_id AS duplicate_id, k.keep_id\n"
+    "FROM packages AS p\n"
+    "JOIN (SELECT name, version, min(package_id) AS keep_id\n"
+    "      FROM packages\n"
+    "      GROUP BY name, version\n"
+    "      HAVING count(*) > 1) AS k\n"
+    "    ON p.name = k.name AND p.version = k.version\n"
+    "WHERE p.package_id != k.keep_id;\n"
+    "UPDATE filelogs SET package_id = (\n"
+    "    SELECT keep_id FROM temp.package_duplicates\n"
+    "    WHERE duplicate_id = filelogs.package_id)\n"
+    "WHERE package_id IN (SELECT duplicate_id FROM temp.package_duplicates);\n"
+    "UPDATE dependencies SET dependant_id = (\n"
+    "    SELECT keep_id FROM temp.package_duplicates\n"
+    "    WHERE duplicate_id = dependencies.dependant_id)\n"
+    "WHERE dependant_id IN (SELECT duplicate_id FROM temp.package_duplicates);\n"
+    "UPDATE dependencies SET package_id = (\n"
+    "    SELECT keep_id FROM temp.package_duplicates\n"
+    "    WHERE duplicate_id = dependencies.package_id)\n"
+    "WHERE package_id IN (SELECT duplicate_id FROM temp.package_duplicates);\n"
+    "DELETE FROM dependencies\n"
+    "WHERE dependency_id NOT IN (\n"
+    "    SELECT min(dependency_id) FROM dependencies\n"
+    "    GROUP BY dependant_id, package_id);\n"
+    "DELETE FROM filelogs\n"
+    "WHERE filelog_id NOT IN (\n"
+    "    SELECT min(filelog_id) FROM filelogs\n"
+    "    GROUP BY package_id, path);\n"
+    "DELETE FROM packages\n"
+    "WHERE package_id IN (SELECT duplicate_id FROM temp.package_duplicates);\n"
+    "DROP TABLE temp.package_duplicates;\n"
+    "DROP INDEX IF EXISTS packages_name_version;\n"
+    "CREATE UNIQUE INDEX IF NOT EXISTS packages_name_version\n"
+    "    ON packages(name, version);\n",
+
+    /* 4 -> 5: a sortable key per version, see version_key (). the index
+     * walks each name's versions in order */
+    "ALTER TABLE packages ADD COLUMN version_key TEXT;\n"
+    "UPDATE packages SET version_key = hemlock_version_key (version);\n"
+    "CREATE INDEX IF NOT EXISTS packages_name_version_key\n"
+    "    ON packages(name, version_key);\n",
+
+    /* 5 -> 6: file logs keep the name, the directory is interned once and
+     * shared, see filepath_dirname_length (). directories no file is left
+     * in are dropped. also points the package key at the right table */
+    "CREATE TABLE IF NOT EXISTS directories (\n"
+    "    directory_id INTEGER PRIMARY KEY,\n"
+    "    path TEXT NOT NULL UNIQUE\n"
+    ");\n"
+    "INSERT OR IGNORE INTO directories (path)\n"
+    "SELECT DISTINCT hemlock_dirname (path) FROM filelogs;\n"
+    "CREATE TABLE filelogs_split (\n"
+    "    filelog_id INTEGER PRIMARY KEY,\n"
+    "    directory_id INTEGER NOT NULL,\n"
+    "    name TEXT NOT NULL,\n"
+    "    package_id INTEGER NOT NULL,\n"
+    "    FOREIGN KEY(directory_id) REFERENCES directories(directory_id),\n"
+    "    FOREIGN KEY(package_id)   REFERENCES packages(package_id)\n"
+    ");\n"
+    "INSERT INTO filelogs_split (filelog_id, directory_id, name, package_id)\n"
+    "SELECT f.filelog_id, d.directory_id, hemlock_basename (f.path),\n"
+    "       f.package_id\n"
+    "FROM filelogs AS f\n"
+    "JOIN directories AS d ON d.path = hemlock_dirname (f.path);\n"
+    "DROP TABLE filelogs;\n"
+    "ALTER TABLE filelogs_split RENAME TO filelogs;\n"
+    "CREATE INDEX IF NOT EXISTS filelogs_directory_name\n"
+    "    ON filelogs(directory_id, name);\n"
+    "CREATE INDEX IF NOT EXISTS filelogs_package_id\n"
+    "    ON filelogs(package_id);\n"
+    "CREATE TRIGGER IF NOT EXISTS filelogs_prune_directory\n"
+    "AFTER DELETE ON filelogs\n"
+    "WHEN NOT EXISTS (SELECT 1 FROM filelogs\n"
+    "                 WHERE directory_id = old.directory_id)\n"
+    "BEGIN\n"
+    "    DELETE FROM directories WHERE directory_id = old.directory_id;\n"
+    "END;\n",
+
+    /* 6 -> 7: each maintainer and email pair is stored once, packages
+     * refer to it. packages is rebuilt rather than altered, DROP COLUMN
+     * needs sqlite 3.35. the full text index reads the name through a
+     * view, and a pair no package refers to anymore is dropped */
+    "CREATE TABLE IF NOT EXISTS maintainers (\n"
+    "    maintainer_id INTEGER PRIMARY KEY,\n"
+    "    maintainer TEXT,\n"
+    "    email TEXT\n"
+    ");\n"
+    "CREATE UNIQUE INDEX IF NOT EXISTS maintainers_maintainer_email\n"
+    "    ON maintainers(maintainer, email);\n"
+    "INSERT INTO maintainers (maintainer, email)\n"
+    "SELECT DISTINCT maintainer, email FROM packages\n"
+    "WHERE maintainer IS NOT NULL OR email IS NOT NULL;\n"
+    "CREATE TABLE packages_interned (\n"
+    "    package_id INTEGER PRIMARY KEY,\n"
+    "    name TEXT NOT NULL,\n"
+    "    version TEXT NOT NULL,\n"
+    "    homepage TEXT,\n"
+    "    as_dependency BOOLEAN,\n"
+    "    is_installed BOOLEAN,\n"
+    "    version_key TEXT,\n"
+    "    maintainer_id INTEGER,\n"
+    "    FOREIGN KEY(maintainer_id) REFERENCES maintainers(maintainer_id)\n"
+    ");\n"
+    "INSERT INTO packages_interned (package_id, name, version, homepage,\n"
+    "                               as_dependency, is_installed,\n"
+    "                               version_key, maintainer_id)\n"
+    "SELECT p.package_id, p.name, p.version, p.homepage, p.as_dependency,\n"
+    "       p.is_installed, p.version_key, m.maintainer_id\n"
+    "FROM packages AS p\n"
+    "LEFT JOIN maintainers AS m\n"
+    "    ON m.maintainer IS p.maintainer AND m.email IS p.email;\n"
+    "DROP TRIGGER IF EXISTS packages_fts_insert;\n"
+    "DROP TRIGGER IF EXISTS packages_fts_delete;\n"
+    "DROP TRIGGER IF EXISTS packages_fts_update;\n"
+    "DROP TABLE IF EXISTS packages_fts;\n"
+    "DROP TABLE packages;\n"
+    "ALTER TABLE packages_interned RENAME TO packages;\n"
+    "CREATE UNIQUE INDEX IF NOT EXISTS packages_name_version\n"
+    "    ON packages(name, version);\n"
+    "CREATE INDEX IF NOT EXISTS packages_name_version_key\n"
+    "    ON packages(name, version_key);\n"
+    "CREATE INDEX IF NOT EXISTS packages_maintainer_id\n"
+    "    ON packages(maintainer_id);\n"
+    "CREATE VIEW IF NOT EXISTS packages_fts_content AS\n"
+    "SELECT p.package_id, p.name, p.homepage, m.maintainer\n"
+    "FROM packages AS p\n"
+    "LEFT JOIN maintainers AS m ON m.maintainer_id = p.maintainer_id;\n"
+    "CREATE VIRTUAL TABLE IF NOT EXISTS packages_fts USING fts5 (\n"
+    "    name, homepage, maintainer,\n"
+    "    content='packages_fts_content', content_rowid='package_id',\n"
+    "    prefix='2 3'\n"
+    ");\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_insert\n"
+    "AFTER INSERT ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (rowid, name, homepage, maintainer)\n"
+    "    VALUES (new.package_id, new.name, new.homepage,\n"
+    "            (SELECT maintainer FROM maintainers\n"
+    "             WHERE maintainer_id = new.maintainer_id));\n"
+    "END;\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_delete\n"
+    "AFTER DELETE ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (packages_fts, rowid, name, homepage,\n"
+    "                              maintainer)\n"
+    "    VALUES ('delete', old.package_id, old.name, old.homepage,\n"
+    "            (SELECT maintainer FROM maintainers\n"
+    "             WHERE maintainer_id = old.maintainer_id));\n"
+    "    DELETE FROM maintainers\n"
+    "    WHERE maintainer_id = old.maintainer_id\n"
+    "      AND NOT EXISTS (SELECT 1 FROM packages\n"
+    "                      WHERE maintainer_id = old.maintainer_id);\n"
+    "END;\n"
+    "CREATE TRIGGER IF NOT EXISTS packages_fts_update\n"
+    "AFTER UPDATE OF name, homepage, maintainer_id ON packages BEGIN\n"
+    "    INSERT INTO packages_fts (packages_fts, rowid, name, homepage,\n"
+    "                              maintainer)\n"
+    "    VALUES ('delete', old.package_id, old.name, old.homepage,\n"
+    "            (SELECT maintainer FROM maintainers\n"
+    "             WHERE maintainer_id = old.maintainer_id));\n"
+    "    INSERT INTO packages_fts (rowid, name, homepage, maintainer)\n"
+    "    VALUES (new.package_id, new.name, new.homepage,\n"
+    "            (SELECT maintainer FROM maintainers\n"
+    "             WHERE maintainer_id = new.maintainer_id));\n"
+    "    DELETE FROM maintainers\n"
+    "    WHERE maintainer_id = old.maintainer_id\n"
+    "      AND NOT EXISTS (SELECT 1 FROM packages\n"
+    "                      WHERE maintainer_id = old.maintainer_id);\n"
+    "END;\n"
+    "INSERT INTO packages_fts (packages_fts) VALUES ('rebuild');\n",
+};
+#define SCHEMA_VERSION \
+    ((int)(sizeof (SCHEMA_MIGRATIONS) / sizeof (*SCHEMA_MIGRATIONS)))
+
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+#define STRINGIFY_VALUE(x) #x
+static const char *SQL_SET_APPLICATION_ID = 
+    "PRAGMA application_id = " STRINGIFY (HEMLOCK_APPLICATION_ID) ";";
+
+
+static int migrate_schema (sqlite3 *db, FILE *log);
+/* columns every package query selects, in db_package_t order */
+#define SQL_PACKAGE_COLUMNS \
+    "p.package_id AS package_id, p.name AS name,\n" \
+    "       p.version AS version, p.homepage AS homepage,\n" \
+    "       m.maintainer AS maintainer, m.email AS email,\n" \
+    "       p.as_dependency AS as_dependency,\n" \
+    "       p.is_installed AS is_installed\n"
+/* the maintainer and email of packages AS p, for SQL_PACKAGE_COLUMNS */
+#define SQL_JOIN_MAINTAINER \
+    "LEFT JOIN maintainers AS m ON m.maintainer_id = p.maintainer_id\n"
+/* the interned id of the maintainer ?4 and email ?5 of bind_package () */
+#define SQL_MAINTAINER_ID \
+    "(SELECT maintainer_id FROM maintainers\n" \
+    "          WHERE maintainer IS ?4 AND email IS ?5)"
+
+/* search conditions on packages AS p, in db_package_filter_t order. the
+ * name and version_key index answers both subqueries */
+#define SQL_FILTER_LATEST \
+    "  AND p.version_key = (SELECT max (n.version_key) FROM packages AS n\n" \
+    "                       WHERE n.name = p.name)\n"
+#define SQL_FILTER_UPGRADABLE \
+    "  AND p.is_installed\n" \
+    "  AND EXISTS (SELECT 1 FROM packages AS n\n" \
+    "              WHERE n.name = p.name AND n.version_key > p.version_key)\n"
+
+/* db_package_t fields a result column can decode into */
+typedef enum
+{
+    COLUMN_UNKNOWN,
+    COLUMN_PACKAGE_ID,
+    COLUMN_NAME,
+    COLUMN_VERSION,
+    COLUMN_HOMEPAGE,
+    COLUMN_MAINTAINER,
+    COLUMN_EMAIL,
+    COLUMN_AS_DEPENDENCY,
+    COLUMN_IS_INSTALLED,
+} package_column_t;
+
+static const struct
+{
+    const char *name;
+    package_column_t column;
+} PACKAGE_COLUMNS[] = 
+{
+    { "package_id",    COLUMN_PACKAGE_ID },
+    { "name",          COLUMN_NAME },
+    { "version",       COLUMN_VERSION },
+    { "homepage",      COLUMN_HOMEPAGE },
+    { "maintainer",    COLUMN_MAINTAINER },
+    { "email",         COLUMN_EMAIL },
+    { "as_dependency", COLUMN_AS_DEPENDENCY },
+    { "is_installed",  COLUMN_IS_INSTALLED },
+};
+#define PACKAGE_COLUMN_COUNT (sizeof (PACKAGE_COLUMNS) / sizeof (*PACKAGE_COLUMNS))
+
+
+static int apply_migration (sqlite3 *db, int version, FILE *log);
+static int gen_package_sets (string_builder_t *builder, 
+                             db_package_t *package);
+static int bind_package (sqlite3_stmt *stmt, db_package_t *package);
+static int intern_maintainer (sqlite3 *db, db_package_t *package, 
+                              FILE *log);
+static int release_maintainer (sqlite3 *db, db_package_t *package, 
+                               FILE *log);
+static int step_remove (sqlite3 *db, int key, const char *SQL, 
+                        int package_id, FILE *log);
+static sqlite3_stmt *bind_search_packages (sqlite3 *db, char *name, 
+                                           char *version, 
+                                           db_package_filter_t filter);
+static char *gen_match_query (const char *query);
+static void cursor_begin (db_package_cursor_t *cursor, sqlite3_stmt *stmt, 
+                          FILE *log);
+static void read_package_row (db_package_cursor_t *cursor, 
+                              db_package_t *package);
+static db_package_t *pack_package (arena_t *arena, const db_package_t *src);
+static char *gen_owner_paths_insert (size_t row_count);
+static int stage_owner_paths (sqlite3 *db, char **paths, size_t path_count,
+                              FILE *log);
+static db_package_t **select_packages (sqlite3_stmt *stmt, arena_t *arena, 
+                                       size_t max_n, size_t *n_out, 
+                                       FILE *log);
+
+
+static int
+apply_migration (sqlite3 *db, int version, FILE *log)
+{
+    string_builder_t builder;
+    char *statement = NULL;
+    int retcode = -1;
 
-    /* validate all string */
-    for (size_t i = 0; i < LIST_COUNT; i++)
+    if (0 != db_execute (db, SCHEMA_MIGRATIONS[version], log)) 
     {
-        if (NULL == escaped_list[i]) goto generate_values_free;
+        fprintf (stderr, "error: schema migration %d -> %d failed\n", 
+                 version, version + 1);
+        return -1;
     }
 
-    /* generate the concatenated string */
-    result = string_join (escaped_list, LIST_COUNT, ", ");
+    /* pragmas cannot take bound parameters, so the version is inlined */
+    string_builder_init (&builder);
+    (void)string_builder_append (&builder, "PRAGMA user_version = ");
+    (void)string_builder_append_int (&builder, version + 1);
+    (void)string_builder_append_char (&builder, ';');
 
-generate_values_free:
-    /* free allocated memory */
-    for (size_t i = 0; i < LIST_COUNT; i++) {
-        free (escaped_list[i]); escaped_list[i] = NULL;
+    statement = string_builder_finish (&builder);
+    if (NULL != statement)
+    {
+        retcode = db_execute (db, statement, log);
     }
 
-    return result;
+    free (statement); statement = NULL;
+
+    return retcode;
 }
 
 
-static char *
-gen_package_sets (db_package_t *package)
+static int
+bind_package (sqlite3_stmt *stmt, db_package_t *package)
 {
-    char *result = NULL;
-    const enum
-    {
-        LIST_NAME,
-        LIST_VERSION,
-        LIST_HOMEPAGE,
-        LIST_MAINTAINER,
-        LIST_EMAIL,
-        LIST_AS_DEPENDENCY,
-        LIST_IS_INSTALLED,
-        LIST_COUNT
-    };
-    char *escaped_list[LIST_COUNT] = {
-        [LIST_NAME]          = db_escape_text (package->name),
-        [LIST_VERSION]       = db_escape_text (package->version),
-        [LIST_HOMEPAGE]      = db_escape_text (package->homepage),
-        [LIST_MAINTAINER]    = db_escape_text (package->maintainer),
-        [LIST_EMAIL]         = db_escape_text (package->email),
-        [LIST_AS_DEPENDENCY] = db_escape_boolean (package->as_dependency),
-        [LIST_IS_INSTALLED]  = db_escape_boolean (package->is_installed),
-    };
-    char *set_format[] = {
-        "name=", escaped_list[LIST_NAME], ", ",
-        "version=", escaped_list[LIST_VERSION], ", ",
-        "homepage=", escaped_list[LIST_HOMEPAGE], ", ",
-        "maintainer=", escaped_list[LIST_MAINTAINER], ", ",
-        "email=", escaped_list[LIST_EMAIL], ", ",
-        "as_dependency=", escaped_list[LIST_AS_DEPENDENCY], ", "
-        "is_installed=", escaped_list[LIST_IS_INSTALLED]
+    /* parameters ?1 to ?7 follow the column order of the packages table */
+    int retcode = SQLITE_OK;
+
+    if (SQLITE_OK == retcode) retcode = db_bind_text (stmt, 1, package->name);
+    if (SQLITE_OK == retcode) retcode = db_bind_text (stmt, 2, package->version);
+    if (SQLITE_OK == retcode) retcode = db_bind_text (stmt, 3, package->homepage);
+    if (SQLITE_OK == retcode) retcode = db_bind_text (stmt, 4, package->maintainer);
+    if (SQLITE_OK == retcode) retcode = db_bind_text (stmt, 5, package->email);
+    if (SQLITE_OK == retcode) retcode = db_bind_boolean (stmt, 6, package->as_dependency);
+    if (SQLITE_OK == retcode) retcode = db_bind_boolean (stmt, 7, package->is_installed);
+
+    return (SQLITE_OK == retcode ? 0 : -1);
+}
+
+
+static int
+intern_maintainer (sqlite3 *db, db_package_t *package, FILE *log)
+{
+    /* adds the package's maintainer and email pair to maintainers unless
+     * it is already there, for SQL_MAINTAINER_ID to find. a package with
+     * neither refers to no pair at all */
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_INTERN = 
+    {
+        "INSERT INTO maintainers (maintainer, email)\n"
+        "SELECT ?1, ?2\n"
+        "WHERE NOT EXISTS (SELECT 1 FROM maintainers\n"
+        "                  WHERE maintainer IS ?1 AND email IS ?2);\n"
     };
-    const size_t FORMAT_LEN = sizeof (set_format) / sizeof (*set_format);
 
-    /* validate all entries */
-    for (int i = 0; i < LIST_COUNT; i++)
+    if ((NULL == package->maintainer) && (NULL == package->email)) return 0;
+
+    stmt = db_prepare_cached (db, STMT_INTERN_MAINTAINER, SQL_INTERN);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != db_bind_text (stmt, 1, package->maintainer))
+     || (SQLITE_OK != db_bind_text (stmt, 2, package->email)))
     {
-        if (NULL == escaped_list[i]) goto generate_sets_free;
+        return -1;
     }
 
-    /* generate the concatenated string */
-    result = string_join (set_format, FORMAT_LEN, "");
+    return db_step_done (stmt, log);
+}
+
+
+static int
+release_maintainer (sqlite3 *db, db_package_t *package, FILE *log)
+{
+    /* undoes intern_maintainer () for a package that was not written,
+     * the pair goes unless another package refers to it */
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_RELEASE = 
+    {
+        "DELETE FROM maintainers\n"
+        "WHERE maintainer IS ?1 AND email IS ?2\n"
+        "  AND NOT EXISTS (SELECT 1 FROM packages AS p\n"
+        "                  WHERE p.maintainer_id = maintainers.maintainer_id);\n"
+    };
+
+    if ((NULL == package->maintainer) && (NULL == package->email)) return 0;
 
-generate_sets_free:
-    /* free allocated memory */
-    for (int i = 0; i < LIST_COUNT; i++) {
-        free (escaped_list[i]); escaped_list[i] = NULL;
+    stmt = db_prepare_cached (db, STMT_RELEASE_MAINTAINER, SQL_RELEASE);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != db_bind_text (stmt, 1, package->maintainer))
+     || (SQLITE_OK != db_bind_text (stmt, 2, package->email)))
+    {
+        return -1;
     }
 
-    return result;
+    return db_step_done (stmt, log);
+}
+
+
+static int
+gen_package_sets (string_builder_t *builder, db_package_t *package)
+{
+    /* name='...', version='...', ... appended to builder as sql values */
+    (void)string_builder_append (builder, "name=");
+    (void)string_builder_append_escaped (builder, package->name, '\'');
+    (void)string_builder_append (builder, ", version=");
+    (void)string_builder_append_escaped (builder, package->version, '\'');
+    (void)string_builder_append (builder, ", homepage=");
+    (void)string_builder_append_escaped (builder, package->homepage, '\'');
+    (void)string_builder_append (builder, ", maintainer=");
+    (void)string_builder_append_escaped (builder, package->maintainer, '\'');
+    (void)string_builder_append (builder, ", email=");
+    (void)string_builder_append_escaped (builder, package->email, '\'');
+    (void)string_builder_append (builder, ", as_dependency=");
+    (void)string_builder_append (builder, 
+                                 (package->as_dependency ? "TRUE" : "FALSE"));
+    (void)string_builder_append (builder, ", is_installed=");
+    (void)string_builder_append (builder, 
+                                 (package->is_installed ? "TRUE" : "FALSE"));
+
+    return (builder->failed ? -1 : 0);
 }
 
 
 char *
 db_human_readable_package (db_package_t *package)
 {
-    return gen_package_sets (package);
+    string_builder_t builder;
+
+    string_builder_init (&builder);
+    (void)gen_package_sets (&builder, package);
+
+    return string_builder_finish (&builder);
+}
+
+
+int
+db_append_readable_package (string_builder_t *builder, 
+                            db_package_t *package)
+{
+    return gen_package_sets (builder, package);
 }
 
 
@@ -133,387 +571,1404 @@ db_free_package (db_package_t *package)
 int
 db_create_tables (sqlite3 *db, FILE *log)
 {
-    const char *SQL_CREATE_TABLES = 
-    {
-        "CREATE TABLE IF NOT EXISTS packages (\n"
-        "    package_id INTEGER PRIMARY KEY,\n"
-        "    name TEXT NOT NULL,\n"
-        "    version TEXT NOT NULL,\n"
-        "    homepage TEXT,\n"
-        "    maintainer TEXT,\n"
-        "    email TEXT,\n"
-        "    as_dependency BOOLEAN,\n"
-        "    is_installed BOOLEAN\n"
-        ");\n"
-        "CREATE TABLE IF NOT EXISTS dependencies (\n"
-        "    dependency_id INTEGER PRIMARY KEY,\n"
-        "    dependant_id INTEGER NOT NULL,\n"
-        "    package_id INTEGER NOT NULL,\n"
-        "    FOREIGN KEY(dependant_id) REFERENCES packages(package_id),\n"
-        "    FOREIGN KEY(package_id)   REFERENCES packages(package_id)\n"
-        ");\n"
-        "CREATE TABLE IF NOT EXISTS filelogs (\n"
-        "    filelog_id INTEGER PRIMARY KEY,\n"
-        "    path TEXT NOT NULL,\n"
-        "    package_id INTEGER NOT NULL,\n"
-        "    FOREIGN KEY(package_id) REFERENCES package(package_id)\n"
-        ");\n"
-    };
+    int retcode = 0;
+    int version = 0;
+    stats_phase_t phase;
+
+    if (NULL == db)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* a current database costs a single header read, without taking the
+     * write lock or running any DDL */
+    phase = stats_phase (STATS_PHASE_SCHEMA);
+    retcode = db_pragma_integer (db, "user_version", &version);
+    if ((0 == retcode) && (SCHEMA_VERSION != version))
+    {
+        retcode = migrate_schema (db, log);
+    }
+    (void)stats_phase (phase);
 
-    return db_execute (db, SQL_CREATE_TABLES, log);
+    return retcode;
 }
 
 
-int
-db_insert_package (sqlite3 *db, db_package_t *package, FILE *log)
+static int
+migrate_schema (sqlite3 *db, FILE *log)
 {
     int retcode = -1;
-    char *escaped_values = NULL;
-    char *insert_statement = NULL;
-    
-    if ((NULL == db) || (NULL == package)) 
+    int version = 0;
+    int application_id = 0;
+
+    /* hold the write lock while reading the version, so two processes
+     * cannot both apply the same migration */
+    if (0 != db_transaction_begin (db, log)) return -1;
+
+    if ((0 != db_pragma_integer (db, "user_version", &version))
+     || (0 != db_pragma_integer (db, "application_id", &application_id)))
     {
-        errno = EINVAL;
-        goto insert_early_exit;
+        goto migrate_schema_exit;
     }
 
-    escaped_values = gen_package_values (package);
-    if (NULL == escaped_values) 
+    if ((0 != application_id) && (HEMLOCK_APPLICATION_ID != application_id))
     {
-        goto insert_early_exit;
+        fprintf (stderr, "error: not a hemlock database, application id %d\n",
+                 application_id);
+        goto migrate_schema_exit;
     }
 
-    char *format_arr[] = 
+    if ((0 > version) || (SCHEMA_VERSION < version))
     {
-        "INSERT INTO packages (package_id,name,version,homepage,maintainer,\n"
-        "                      email,as_dependency,is_installed)\n"
-        "VALUES ( ", escaped_values, " );\n"
-    };
-    const size_t format_count = sizeof (format_arr) / sizeof (*format_arr);
+        fprintf (stderr, "error: unsupported database schema version %d, "
+                 "expected at most %d\n", version, SCHEMA_VERSION);
+        goto migrate_schema_exit;
+    }
+
+    /* apply every migration the file has not seen yet, in order */
+    for (; version < SCHEMA_VERSION; version++)
+    {
+        if (0 != apply_migration (db, version, log)) 
+        {
+            goto migrate_schema_exit;
+        }
+    }
 
-    insert_statement = string_join (format_arr, format_count, "");
-    if (NULL == insert_statement)
+    /* tag the file as ours, so foreign databases are refused above */
+    if ((0 == application_id) 
+     && (0 != db_execute (db, SQL_SET_APPLICATION_ID, log)))
     {
-        goto insert_early_exit;
+        goto migrate_schema_exit;
     }
 
-    retcode = db_execute (db, insert_statement, log);
+    retcode = 0;
 
-insert_early_exit:
-    free (insert_statement); insert_statement = NULL;
-    free (escaped_values);   escaped_values = NULL;
+migrate_schema_exit:
+    if (0 == retcode)
+    {
+        retcode = db_transaction_commit (db, log);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, log);
+    }
 
     return retcode;
-
 }
 
 
 int
-db_update_package (sqlite3 *db, db_package_t *package, FILE *log)
+db_insert_package (sqlite3 *db, db_package_t *package, FILE *log)
 {
-    int retcode = -1;
-    char *package_id = NULL;
-    char *escaped_sets = NULL;
-    char *update_statement = NULL;
+    /* the unique name and version index doubles as the duplicate check.
+     * returns 0 on insert, 1 if the package already exists, -1 on error */
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_INSERT = 
+    {
+        "INSERT INTO packages (name,version,homepage,maintainer_id,\n"
+        "                      as_dependency,is_installed,version_key)\n"
+        "VALUES ( ?1, ?2, ?3, " SQL_MAINTAINER_ID ", ?6, ?7,\n"
+        "         hemlock_version_key (?2) )\n"
+        "ON CONFLICT (name, version) DO NOTHING;\n"
+    };
     
     if ((NULL == db) || (NULL == package)) 
     {
         errno = EINVAL;
-        goto update_early_exit;
+        return -1;
+    }
+
+    if (0 != intern_maintainer (db, package, log)) return -1;
+
+    stmt = db_prepare_cached (db, STMT_INSERT_PACKAGE, SQL_INSERT);
+    if ((NULL == stmt) || (0 != bind_package (stmt, package)))
+    {
+        return -1;
     }
 
-    package_id = int_to_string (package->package_id);
-    escaped_sets = gen_package_sets (package);
-    if ((NULL == package_id) || (NULL == escaped_sets)) 
+    if (0 != db_step_done (stmt, log)) return -1;
+    if (0 == sqlite3_changes (db)) 
     {
-        goto update_early_exit;
+        /* a duplicate, the pair interned for it may have no other use */
+        return ((0 == release_maintainer (db, package, log)) ? 1 : -1);
     }
 
-    char *format_arr[] = 
+    /* hand the new id back, for filelogs and dependencies */
+    package->package_id = (int)sqlite3_last_insert_rowid (db);
+    package->valid |= PACKAGE_VALID_PACKAGE_ID;
+
+    return 0;
+}
+
+
+int
+db_upsert_package (sqlite3 *db, db_package_t *package, FILE *log)
+{
+    /* inserts the package, or overwrites the fields of the one with the
+     * same name and version. either way the package id is handed back.
+     * returns 0 on success, -1 on error */
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_UPSERT = 
     {
-        "UPDATE packages\n"
-        "SET ", escaped_sets, "\n"
-        "WHERE package_id = ", package_id, ";\n"
+        "INSERT INTO packages (name,version,homepage,maintainer_id,\n"
+        "                      as_dependency,is_installed,version_key)\n"
+        "VALUES ( ?1, ?2, ?3, " SQL_MAINTAINER_ID ", ?6, ?7,\n"
+        "         hemlock_version_key (?2) )\n"
+        "ON CONFLICT (name, version) DO UPDATE\n"
+        "SET homepage = excluded.homepage,\n"
+        "    maintainer_id = excluded.maintainer_id,\n"
+        "    as_dependency = excluded.as_dependency,\n"
+        "    is_installed = excluded.is_installed\n"
+        "WHERE homepage IS NOT excluded.homepage\n"
+        "   OR maintainer_id IS NOT excluded.maintainer_id\n"
+        "   OR as_dependency IS NOT excluded.as_dependency\n"
+        "   OR is_installed IS NOT excluded.is_installed;\n"
     };
-    const size_t format_count = sizeof (format_arr) / sizeof (*format_arr);
 
-    update_statement = string_join (format_arr, format_count, "");
-    if (NULL == update_statement)
+    if ((NULL == db) || (NULL == package)) 
     {
-        goto update_early_exit;
+        errno = EINVAL;
+        return -1;
     }
 
-    retcode = db_execute (db, update_statement, log);
+    if (0 != intern_maintainer (db, package, log)) return -1;
 
-update_early_exit:
-    free (update_statement); update_statement = NULL;
-    free (escaped_sets);     escaped_sets = NULL;
-    free (package_id);       package_id = NULL;
+    stmt = db_prepare_cached (db, STMT_UPSERT_PACKAGE, SQL_UPSERT);
+    if ((NULL == stmt) || (0 != bind_package (stmt, package)))
+    {
+        return -1;
+    }
 
-    return retcode;
-}
+    db_log_statement (stmt, log);
+    retcode = sqlite3_step (stmt);
+    (void)sqlite3_reset (stmt);
 
+    if (SQLITE_DONE != retcode)
+    {
+        fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, 
+                 sqlite3_errmsg (db));
+        return -1;
+    }
 
-db_package_t *
-db_search_package_id (sqlite3 *db, int id, FILE *log)
-{ 
-    char *select_statement = NULL;
-    char *package_id = NULL;
+    /* the row was inserted, updated or left alone, the name and version
+     * find it either way. RETURNING would need sqlite 3.35 */
+    if (0 != db_find_package (db, package->name, package->version, 
+                              &package->package_id, log))
+    {
+        return -1;
+    }
 
-    db_package_t *match = NULL;
-    size_t match_count = 0;
-    const size_t MATCH_MAX = 1;
+    package->valid |= PACKAGE_VALID_PACKAGE_ID;
 
-    if (NULL == db)
+    return 0;
+}
+
+
+int
+db_insert_filelog (sqlite3 *db, int package_id, const char *path, FILE *log)
+{
+    /* the directory is interned first, the file log then refers to it */
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+    size_t dirname_length = 0;
+    sqlite3_int64 directory_id = 0;
+    const char *SQL_DIRECTORY = 
     {
-        errno = EINVAL;
-        goto search_id_early_exit;
-    }    
-    
-    package_id = int_to_string (id);
-    if (NULL == package_id)
+        "SELECT directory_id FROM directories WHERE path = ?1;\n"
+    };
+    const char *SQL_NEW_DIRECTORY = 
     {
-        goto search_id_early_exit;
-    }
-
-    char *format_arr[] = 
+        "INSERT INTO directories (path)\n"
+        "VALUES ( ?1 );\n"
+    };
+    const char *SQL_INSERT = 
     {
-        "SELECT *\n"
-        "FROM packages\n"
-        "WHERE package_id = ", package_id, ";\n"
+        "INSERT INTO filelogs (directory_id, name, package_id)\n"
+        "VALUES ( ?1, ?2, ?3 );\n"
     };
-    const size_t format_count = sizeof (format_arr) / sizeof (*format_arr);
 
-    select_statement = string_join (format_arr, format_count, "");
-    if (NULL == select_statement)
+    if ((NULL == db) || (NULL == path))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    dirname_length = filepath_dirname_length (path);
+
+    /* called once per file, the cached statements only ever rebind. most
+     * files share their directory with one logged before them */
+    stmt = db_prepare_cached (db, STMT_FIND_DIRECTORY, SQL_DIRECTORY);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != sqlite3_bind_text (stmt, 1, path, (int)dirname_length, 
+                                         SQLITE_STATIC)))
     {
-        goto search_id_early_exit;
+        return -1;
     }
 
-    match = select_packages (db, select_statement, MATCH_MAX, 
-                             &match_count, log);
+    db_log_statement (stmt, log);
+    retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) directory_id = sqlite3_column_int64 (stmt, 0);
+    (void)sqlite3_reset (stmt);
+
+    if (SQLITE_DONE == retcode)
+    {
+        stmt = db_prepare_cached (db, STMT_INSERT_DIRECTORY, 
+                                  SQL_NEW_DIRECTORY);
+        if ((NULL == stmt) 
+         || (SQLITE_OK != sqlite3_bind_text (stmt, 1, path, 
+                                             (int)dirname_length, 
+                                             SQLITE_STATIC))
+         || (0 != db_step_done (stmt, log)))
+        {
+            return -1;
+        }
+        directory_id = sqlite3_last_insert_rowid (db);
+    }
+    else if (SQLITE_ROW != retcode)
+    {
+        fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, 
+                 sqlite3_errmsg (db));
+        return -1;
+    }
 
-search_id_early_exit:
-    free (select_statement); select_statement = NULL;
-    free (package_id);       package_id = NULL;
+    stmt = db_prepare_cached (db, STMT_INSERT_FILELOG, SQL_INSERT);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != sqlite3_bind_int64 (stmt, 1, directory_id))
+     || (SQLITE_OK != db_bind_text (stmt, 2, path + dirname_length))
+     || (SQLITE_OK != db_bind_integer (stmt, 3, package_id)))
+    {
+        return -1;
+    }
 
-    return match;
+    return db_step_done (stmt, log);
 }
 
 
-db_package_t *
-db_search_packages (sqlite3 *db, char *name, char *version, size_t *n_out, 
-                    FILE *log)
+uint32_t
+db_package_diff (const db_package_t *current, db_package_t *package)
 {
-    char *select_statement = NULL;
-    char *escaped_name = NULL, *escaped_version = NULL;
+    /* clears the valid bit of every field in package that already holds
+     * the value in current, leaving only the fields that would change */
+    const struct { uint32_t bit; size_t offset; } TEXT_FIELDS[] = 
+    {
+        { PACKAGE_VALID_NAME,       offsetof (db_package_t, name) },
+        { PACKAGE_VALID_VERSION,    offsetof (db_package_t, version) },
+        { PACKAGE_VALID_HOMEPAGE,   offsetof (db_package_t, homepage) },
+        { PACKAGE_VALID_MAINTAINER, offsetof (db_package_t, maintainer) },
+        { PACKAGE_VALID_EMAIL,      offsetof (db_package_t, email) },
+    };
+    const size_t TEXT_COUNT = sizeof (TEXT_FIELDS) / sizeof (*TEXT_FIELDS);
+    const char *a = NULL, *b = NULL;
 
-    db_package_t *match_arr = NULL;
-    size_t match_count = 0;
+    if ((NULL == current) || (NULL == package)) return PACKAGE_INVALID;
 
-    const char *DEFAULT_VERSION = "%";
+    for (size_t i = 0; i < TEXT_COUNT; i++)
+    {
+        if (!(package->valid & TEXT_FIELDS[i].bit)) continue;
 
-    if ((NULL == db) || (NULL == name) || (NULL == n_out))
+        a = *(char **)((char *)current + TEXT_FIELDS[i].offset);
+        b = *(char **)((char *)package + TEXT_FIELDS[i].offset);
+        if ((a == b) || ((NULL != a) && (NULL != b) && (0 == strcmp (a, b))))
+        {
+            package->valid &= ~TEXT_FIELDS[i].bit;
+        }
+    }
+
+    if (current->as_dependency == package->as_dependency)
     {
-        errno = EINVAL;
-        goto search_name_early_exit;
+        package->valid &= ~PACKAGE_VALID_AS_DEPENDENCY;
+    }
+    if (current->is_installed == package->is_installed)
+    {
+        package->valid &= ~PACKAGE_VALID_IS_INSTALLED;
     }
 
-    version = (char *)(NULL == version ? DEFAULT_VERSION : version);
+    return (package->valid & ~PACKAGE_VALID_PACKAGE_ID);
+}
+
 
-    escaped_version = db_escape_text (version);
-    escaped_name    = db_escape_text (name);
-    if ((NULL == escaped_name) ||
-        (NULL == escaped_version))
+int
+db_update_package (sqlite3 *db, db_package_t *package, FILE *log)
+{
+    /* writes only the columns whose valid bit is set, so untouched
+     * columns cost no index or trigger work. nothing to write is not an
+     * error, and runs no statement at all. the maintainer and email are
+     * stored as a pair, either bit writes both */
+    int retcode = -1;
+    sqlite3_stmt *stmt = NULL;
+    char *sql = NULL;
+    string_builder_t builder;
+    /* placeholders match bind_package, ?8 is the package_id */
+    const struct { uint32_t bit; char *set; } COLUMNS[] = 
+    {
+        { PACKAGE_VALID_NAME,          "name = ?1" },
+        { PACKAGE_VALID_VERSION,       "version = ?2, "
+                                       "version_key = hemlock_version_key (?2)" },
+        { PACKAGE_VALID_HOMEPAGE,      "homepage = ?3" },
+        { PACKAGE_VALID_MAINTAINER | PACKAGE_VALID_EMAIL,
+                                       "maintainer_id = " SQL_MAINTAINER_ID },
+        { PACKAGE_VALID_AS_DEPENDENCY, "as_dependency = ?6" },
+        { PACKAGE_VALID_IS_INSTALLED,  "is_installed = ?7" },
+    };
+    const size_t COLUMN_COUNT = sizeof (COLUMNS) / sizeof (*COLUMNS);
+    
+    if ((NULL == db) || (NULL == package) 
+     || (!(package->valid & PACKAGE_VALID_PACKAGE_ID))) 
     {
-        goto search_name_early_exit;
+        errno = EINVAL;
+        return -1;
     }
 
-    char *format_arr[] = 
+    if (0 == (package->valid & ~PACKAGE_VALID_PACKAGE_ID)) return 0;
+    if ((package->valid & (PACKAGE_VALID_MAINTAINER | PACKAGE_VALID_EMAIL))
+     && (0 != intern_maintainer (db, package, log)))
     {
-        "SELECT *\n"
-        "FROM packages\n"
-        "WHERE name    like ", escaped_name, " AND\n"
-        "      version like ", escaped_version, ";\n"
-    };
-    const size_t FORMAT_LEN = sizeof (format_arr) / sizeof (*format_arr);
+        return -1;
+    }
 
-    select_statement = string_join (format_arr, FORMAT_LEN, "");
-    if (NULL == select_statement)
+    /* UPDATE packages SET <columns> WHERE package_id = ?8; */
+    string_builder_init (&builder);
+    (void)string_builder_append (&builder, "UPDATE packages\nSET ");
+    for (size_t i = 0, set_count = 0; i < COLUMN_COUNT; i++)
     {
-        goto search_name_early_exit;
+        if (!(package->valid & COLUMNS[i].bit)) continue;
+
+        if (0 < set_count++) (void)string_builder_append (&builder, ", ");
+        (void)string_builder_append (&builder, COLUMNS[i].set);
     }
+    (void)string_builder_append (&builder, "\nWHERE package_id = ?8;\n");
+
+    sql = string_builder_finish (&builder);
+    if (NULL == sql) return -1;
 
-    match_arr = select_packages (db, select_statement, SIZE_MAX, 
-                                 &match_count, log);
+    /* up to 2^6 column sets, too many to keep cached */
+    stmt = db_prepare (db, sql);
+    if ((NULL != stmt) && (0 == bind_package (stmt, package))
+     && (SQLITE_OK == db_bind_integer (stmt, 8, package->package_id)))
+    {
+        retcode = db_step_done (stmt, log);
+    }
 
-search_name_early_exit:
-    free (escaped_version);  escaped_version  = NULL;
-    free (escaped_name);     escaped_name     = NULL;
-    free (select_statement); select_statement = NULL;
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+    free (sql); sql = NULL;
 
-    *n_out = match_count;
-    return match_arr;
+    return retcode;
 }
 
 
-static db_package_t *
-select_packages (sqlite3 *db, char *sql_statement, size_t max_n, 
-                 size_t *n_out, FILE *log)
+int
+db_insert_dependency (sqlite3 *db, int dependant_id, int package_id, 
+                      FILE *log)
 {
-    int retcode = 0;
-    size_t statement_length = 0;
     sqlite3_stmt *stmt = NULL;
+    const char *SQL_INSERT = 
+    {
+        "INSERT INTO dependencies (dependant_id, package_id)\n"
+        "VALUES ( ?1, ?2 );\n"
+    };
 
-    void *temp = NULL;
-    const size_t DEFAULT_ALLOC = 3;
-    size_t min_initial_alloc = 0;
-    size_t result_count = 0;
-    size_t result_alloc = 0;
-    db_package_t *result = NULL;
-    db_package_t *iter = NULL;
-
-    db_result_t out = { .type = SQLITE_NULL, .s = NULL };
-    char *col_name = NULL;
-    size_t col_n = 0;
-
-    if ((NULL == db) || (NULL == sql_statement) || (0 == max_n)
-     || (NULL == n_out))
+    if (NULL == db)
     {
         errno = EINVAL;
-        goto select_package_exit;
+        return -1;
     }
 
-    if (NULL != log) fprintf (log, "%s", sql_statement);
-    statement_length = strlen (sql_statement);
-    retcode = sqlite3_prepare_v2 (db, sql_statement, (int)statement_length, 
-                                  &stmt, NULL);
-    if ((SQLITE_OK != retcode) || (NULL == stmt))
+    stmt = db_prepare_cached (db, STMT_INSERT_DEPENDENCY, SQL_INSERT);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != db_bind_integer (stmt, 1, dependant_id))
+     || (SQLITE_OK != db_bind_integer (stmt, 2, package_id)))
     {
-        fprintf (stderr, "SQLite3 Error: %d: Failed to prepare statement\n", 
-                 retcode);
-        goto select_package_exit;
+        return -1;
     }
 
-    min_initial_alloc = min (max_n, DEFAULT_ALLOC);
-    result = malloc (min_initial_alloc * sizeof (db_package_t));
-    if (NULL == result)
+    return db_step_done (stmt, log);
+}
+
+
+int
+db_resolve_package (sqlite3 *db, const char *name, int *package_id_out, 
+                    FILE *log)
+{
+    /* finds the package a dependency on name refers to, preferring an
+     * installed version, then the newest. returns 0 when found, 1 when
+     * no package has that name, -1 on error */
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_SELECT = 
     {
-        errno = ENOMEM;
-        goto select_package_exit;
+        "SELECT package_id\n"
+        "FROM packages\n"
+        "WHERE name = ?1\n"
+        "ORDER BY is_installed DESC, version_key DESC, package_id DESC\n"
+        "LIMIT 1;\n"
+    };
+
+    if ((NULL == db) || (NULL == name) || (NULL == package_id_out))
+    {
+        errno = EINVAL;
+        return -1;
     }
-    result_alloc = min_initial_alloc;
 
-    while (SQLITE_ROW == (retcode = sqlite3_step (stmt)))
+    stmt = db_prepare_cached (db, STMT_RESOLVE_PACKAGE, SQL_SELECT);
+    if ((NULL == stmt) || (SQLITE_OK != db_bind_text (stmt, 1, name)))
     {
-        /* check if max_n count has been reached */
-        if (result_count == max_n) break;
+        return -1;
+    }
 
-        /* ensure that the result array is large enough */
-        if (result_count == result_alloc)
-        {
-            temp = realloc (result, (result_alloc * 2) 
-                                    * sizeof (db_package_t));
-            /* if realloc fails, cleanup result and abort */
-            if (NULL == temp)
-            {
-                free (result); result = NULL;
-                result_count = 0;
-                result_alloc = 0;
-                errno = ENOMEM;
-                goto select_package_exit;
-            }
-            result = temp;
-            result_alloc *= 2;
-        }
+    db_log_statement (stmt, log);
+    retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) *package_id_out = sqlite3_column_int (stmt, 0);
+    (void)sqlite3_reset (stmt);
 
-        /* define iterator */
-        iter = result + result_count;
+    if (SQLITE_ROW == retcode) return 0;
+    if (SQLITE_DONE == retcode) return 1;
 
-        /* define default values */
-        (void)memset (iter, 0, sizeof (db_package_t));
-        iter->valid = PACKAGE_INVALID;
+    fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, sqlite3_errmsg (db));
+    return -1;
+}
 
-        /* get values */
-        col_n = sqlite3_column_count (stmt);
-        for (int i = 0; i < col_n; i++)
-        {
-            (void)db_get_column (stmt, i, &out);
-    
-            col_name = (char *)sqlite3_column_name (stmt, i);
-            if (NULL == col_name)
-            {
-                fprintf (stderr, "panic col_name == NULL\n");
-            }
 
-            if ((0 == strcmp (col_name, "package_id")) 
-             && (SQLITE_INTEGER == out.type)) 
-            {
-                iter->package_id = out.i;
-                iter->valid |= PACKAGE_VALID_PACKAGE_ID;
-            }
-            else if ((0 == strcmp (col_name, "name"))
-                  && (SQLITE_TEXT == out.type))
-            {
-                iter->name = string_clone (out.s);
-                iter->valid |= PACKAGE_VALID_NAME;
-            }
-            else if ((0 == strcmp (col_name, "version"))
-                  && (SQLITE_TEXT == out.type))
-            {
-                iter->version = string_clone (out.s);
-                iter->valid |= PACKAGE_VALID_VERSION;
-            }
-            else if ((0 == strcmp (col_name, "homepage"))
-                  && ((SQLITE_TEXT == out.type)
-                   || (SQLITE_NULL == out.type)))
-            {
-                iter->homepage = string_clone (out.s);
-                iter->valid |= PACKAGE_VALID_HOMEPAGE;
-            }
-            else if ((0 == strcmp (col_name, "maintainer"))
-                  && ((SQLITE_TEXT == out.type)
-                   || (SQLITE_NULL == out.type)))
-            {
-                iter->maintainer = string_clone (out.s);
-                iter->valid |= PACKAGE_VALID_MAINTAINER;
-            }
-            else if ((0 == strcmp (col_name, "email"))
-                  && ((SQLITE_TEXT == out.type)
-                   || (SQLITE_NULL == out.type)))
-            {
-                iter->email = string_clone (out.s);
-                iter->valid |= PACKAGE_VALID_EMAIL;
-            }
-            else if ((0 == strcmp (col_name, "as_dependency")) 
-                  && (SQLITE_INTEGER == out.type)) 
-            {
-                iter->as_dependency = (out.i == 1 ? true : false);
-                iter->valid |= PACKAGE_VALID_AS_DEPENDENCY;
-            }
-            else if ((0 == strcmp (col_name, "is_installed")) 
-                  && (SQLITE_INTEGER == out.type)) 
-            {
-                iter->is_installed = (out.i == 1 ? true : false);
-                iter->valid |= PACKAGE_VALID_IS_INSTALLED;
-            }
-            else
-            {
-                fprintf (stderr, "SQLite Warning: skipping bad column\n");
-            }
+int
+db_find_package (sqlite3 *db, const char *name, const char *version, 
+                 int *package_id_out, FILE *log)
+{
+    /* exact name and version lookup. returns 0 when found, 1 when there
+     * is no such package, -1 on error */
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+    const char *SQL_SELECT = 
+    {
+        "SELECT package_id\n"
+        "FROM packages\n"
+        "WHERE name = ?1 AND version = ?2;\n"
+    };
 
-            
-        }
+    if ((NULL == db) || (NULL == name) || (NULL == version) 
+     || (NULL == package_id_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
-        /* increment */
-        result_count++;
+    stmt = db_prepare_cached (db, STMT_FIND_PACKAGE, SQL_SELECT);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != db_bind_text (stmt, 1, name))
+     || (SQLITE_OK != db_bind_text (stmt, 2, version)))
+    {
+        return -1;
     }
 
-select_package_exit:
-    /* clean up temporary memory */
+    db_log_statement (stmt, log);
+    retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) *package_id_out = sqlite3_column_int (stmt, 0);
     (void)sqlite3_reset (stmt);
-    (void)sqlite3_finalize (stmt); stmt = NULL;
 
+    if (SQLITE_ROW == retcode) return 0;
+    if (SQLITE_DONE == retcode) return 1;
+
+    fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, sqlite3_errmsg (db));
+    return -1;
+}
+
+
+static int
+step_remove (sqlite3 *db, int key, const char *SQL, int package_id, 
+             FILE *log)
+{
+    /* runs one of the removal statements, binding package_id to ?1 when
+     * the statement takes it. returns the number of rows changed */
+    sqlite3_stmt *stmt = db_prepare_cached (db, key, SQL);
+    if (NULL == stmt) return -1;
+
+    if ((0 < sqlite3_bind_parameter_count (stmt))
+     && (SQLITE_OK != db_bind_integer (stmt, 1, package_id)))
+    {
+        return -1;
+    }
+
+    if (0 != db_step_done (stmt, log)) return -1;
+
+    return sqlite3_changes (db);
+}
+
+
+int
+db_remove_package (sqlite3 *db, int package_id, bool cascade, bool force,
+                   size_t *removed_out, FILE *log)
+{
+    /* removes the package, its filelogs and its dependency edges. with
+     * cascade, dependency-only packages left without any dependant go
+     * too. run inside a transaction; returns 0 on success, 1 if other
+     * packages still depend on it (unless forced), -1 on error */
+    int retcode = 0;
+    const char *SQL_REMOVE_SET = 
+    {
+        "CREATE TEMP TABLE IF NOT EXISTS remove_set (\n"
+        "    package_id INTEGER PRIMARY KEY\n"
+        ");\n"
+        "DELETE FROM temp.remove_set;\n"
+    };
+    const char *SQL_SEED = 
+    {
+        "INSERT INTO temp.remove_set (package_id) VALUES ( ?1 );\n"
+    };
+    const char *SQL_CASCADE = 
+    {
+        "WITH RECURSIVE closure (package_id) AS (\n"
+        "    SELECT ?1\n"
+        "    UNION\n"
+        "    SELECT d.package_id\n"
+        "    FROM dependencies AS d\n"
+        "    JOIN closure AS c ON d.dependant_id = c.package_id\n"
+        "    JOIN packages AS p ON p.package_id = d.package_id\n"
+        "    WHERE p.as_dependency\n"
+        ")\n"
+        "INSERT OR IGNORE INTO temp.remove_set (package_id)\n"
+        "SELECT package_id FROM closure;\n"
+    };
+    /* a member still required from outside the set stays, and so does
+     * everything in the set below it */
+    const char *SQL_PRUNE = 
+    {
+        "WITH RECURSIVE kept (package_id) AS (\n"
+        "    SELECT r.package_id\n"
+        "    FROM temp.remove_set AS r\n"
+        "    WHERE r.package_id != ?1 AND EXISTS (\n"
+        "        SELECT 1 FROM dependencies AS d\n"
+        "        WHERE d.package_id = r.package_id\n"
+        "          AND d.dependant_id NOT IN temp.remove_set)\n"
+        "    UNION\n"
+        "    SELECT d.package_id\n"
+        "    FROM dependencies AS d\n"
+        "    JOIN kept AS k ON d.dependant_id = k.package_id\n"
+        "    WHERE d.package_id != ?1\n"
+        "      AND d.package_id IN temp.remove_set\n"
+        ")\n"
+        "DELETE FROM temp.remove_set\n"
+        "WHERE package_id IN kept;\n"
+    };
+    const char *SQL_BLOCKING = 
+    {
+        "SELECT count(*) FROM dependencies\n"
+        "WHERE package_id IN temp.remove_set\n"
+        "  AND dependant_id NOT IN temp.remove_set;\n"
+    };
+    const char *SQL_FILELOGS = 
+    {
+        "DELETE FROM filelogs\n"
+        "WHERE package_id IN temp.remove_set;\n"
+    };
+    const char *SQL_DEPENDENCIES = 
+    {
+        "DELETE FROM dependencies\n"
+        "WHERE dependant_id IN temp.remove_set\n"
+        "   OR package_id IN temp.remove_set;\n"
+    };
+    const char *SQL_PACKAGES = 
+    {
+        "DELETE FROM packages\n"
+        "WHERE package_id IN temp.remove_set;\n"
+    };
+    sqlite3_stmt *stmt = NULL;
+    int changes = 0;
+
+    if (NULL == db)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (NULL != removed_out) *removed_out = 0;
+
+    /* gather the packages to remove in a temporary table */
+    if (0 != db_execute (db, SQL_REMOVE_SET, log)) return -1;
+    if (cascade)
+    {
+        /* every dependency-only package reachable from the root ... */
+        if (0 > step_remove (db, STMT_REMOVE_CASCADE, SQL_CASCADE, 
+                             package_id, log)) return -1;
+
+        /* ... less those still needed by a package outside the set, and
+         * the ones below them, in one pass however deep the graph */
+        if (0 > step_remove (db, STMT_REMOVE_PRUNE, SQL_PRUNE, 
+                             package_id, log)) return -1;
+    }
+    else
+    {
+        if (0 > step_remove (db, STMT_REMOVE_SEED, SQL_SEED, package_id, 
+                             log)) return -1;
+    }
+
+    /* refuse to strand the root's dependants */
+    stmt = db_prepare_cached (db, STMT_REMOVE_BLOCKING, SQL_BLOCKING);
+    if (NULL == stmt) return -1;
+    db_log_statement (stmt, log);
+    if (SQLITE_ROW == sqlite3_step (stmt)) changes = sqlite3_column_int (stmt, 0);
+    else changes = -1;
+    (void)sqlite3_reset (stmt);
+
+    if (0 > changes) return -1;
+    if ((0 < changes) && (!force)) return 1;
+
+    /* a handful of set based deletes, however large the set */
+    if ((0 > step_remove (db, STMT_REMOVE_FILELOGS, SQL_FILELOGS, 
+                          package_id, log))
+     || (0 > step_remove (db, STMT_REMOVE_DEPENDENCIES, SQL_DEPENDENCIES, 
+                          package_id, log)))
+    {
+        return -1;
+    }
+
+    retcode = step_remove (db, STMT_REMOVE_PACKAGES, SQL_PACKAGES, 
+                           package_id, log);
+    if (0 > retcode) return -1;
+
+    if (NULL != removed_out) *removed_out = (size_t)retcode;
+    return 0;
+}
+
+
+int
+db_clear_filelogs (sqlite3 *db, int package_id, FILE *log)
+{
+    /* drops every file logged to the package, ahead of logging anew */
+    const char *SQL_DELETE = 
+    {
+        "DELETE FROM filelogs WHERE package_id = ?1;\n"
+    };
+
+    if (NULL == db)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return ((0 > step_remove (db, STMT_CLEAR_FILELOGS, SQL_DELETE, 
+                              package_id, log)) ? -1 : 0);
+}
+
+
+int
+db_clear_requirements (sqlite3 *db, int package_id, FILE *log)
+{
+    /* drops the package's edges to the packages it requires. edges from
+     * its own dependants are kept */
+    const char *SQL_DELETE = 
+    {
+        "DELETE FROM dependencies WHERE dependant_id = ?1;\n"
+    };
+
+    if (NULL == db)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return ((0 > step_remove (db, STMT_CLEAR_REQUIREMENTS, SQL_DELETE, 
+                              package_id, log)) ? -1 : 0);
+}
+
+
+/* paths staged per insert by db_search_file_owner (), two parameters each
+ * keeps a chunk under SQLite's oldest 999 parameter limit */
+#define OWNER_PATHS_CHUNK 256
+
+
+static char *
+gen_owner_paths_insert (size_t row_count)
+{
+    /* INSERT INTO temp.owner_paths VALUES (?1, ?2), (?3, ?4), ... */
+    string_builder_t builder;
+
+    string_builder_init (&builder);
+    (void)string_builder_append (&builder, 
+            "INSERT INTO temp.owner_paths (path_index, path)\nVALUES ");
+    for (size_t i = 0; i < row_count; i++)
+    {
+        if (0 < i) (void)string_builder_append (&builder, ", ");
+        (void)string_builder_append (&builder, "(?");
+        (void)string_builder_append_int (&builder, (int)(i * 2) + 1);
+        (void)string_builder_append (&builder, ", ?");
+        (void)string_builder_append_int (&builder, (int)(i * 2) + 2);
+        (void)string_builder_append_char (&builder, ')');
+    }
+    (void)string_builder_append (&builder, ";\n");
+
+    return string_builder_finish (&builder);
+}
+
+
+static int
+stage_owner_paths (sqlite3 *db, char **paths, size_t path_count, FILE *log)
+{
+    /* copies the paths into the temp table, a chunk per statement. full
+     * chunks share one cached statement, the last one is compiled alone */
+    int retcode = 0;
+    sqlite3_stmt *stmt = NULL;
+    char *sql = NULL;
+    size_t chunk = 0;
+
+    for (size_t first = 0; (first < path_count) && (0 == retcode); 
+         first += chunk)
+    {
+        chunk = path_count - first;
+        if (OWNER_PATHS_CHUNK < chunk) chunk = OWNER_PATHS_CHUNK;
+
+        sql = gen_owner_paths_insert (chunk);
+        if (NULL == sql) return -1;
+        stmt = ((OWNER_PATHS_CHUNK == chunk) 
+                ? db_prepare_cached (db, STMT_STAGE_OWNER_PATHS, sql)
+                : db_prepare (db, sql));
+        free (sql); sql = NULL;
+        if (NULL == stmt) return -1;
+
+        for (size_t i = 0; (i < chunk) && (0 == retcode); i++)
+        {
+            if ((SQLITE_OK != sqlite3_bind_int64 (stmt, (int)(i * 2) + 1, 
+                                                  (sqlite3_int64)(first + i)))
+             || (SQLITE_OK != db_bind_text (stmt, (int)(i * 2) + 2, 
+                                            paths[first + i])))
+            {
+                retcode = -1;
+            }
+        }
+        if (0 == retcode) retcode = db_step_done (stmt, log);
+
+        /* db_step_done () resets the statement, the cached one stays */
+        if (OWNER_PATHS_CHUNK != chunk) (void)sqlite3_finalize (stmt);
+        stmt = NULL;
+    }
+
+    return retcode;
+}
+
+
+int
+db_search_file_owner (sqlite3 *db, arena_t *arena, char **paths, 
+                      size_t path_count, db_file_owner_t **owners_out, 
+                      size_t *n_out, FILE *log)
+{
+    /* every path is looked up in one query: the paths are staged in a
+     * temp table, then split and joined through the directory and the
+     * filelogs name index. owners come back ordered by path, paths
+     * nothing owns are left out */
+    int retcode = -1;
+    sqlite3_stmt *stmt = NULL;
+    void *temp = NULL;
+    db_file_owner_t *owners = NULL;
+    size_t owner_count = 0, owner_alloc = 0;
+    db_package_t row;
+    const char *SQL_STAGE = 
+    {
+        "CREATE TEMP TABLE IF NOT EXISTS owner_paths (\n"
+        "    path_index INTEGER PRIMARY KEY,\n"
+        "    path TEXT NOT NULL\n"
+        ");\n"
+        "DELETE FROM temp.owner_paths;\n"
+    };
+    /* cross join keeps the staged paths as the outer loop */
+    const char *SQL_SELECT = 
+    {
+        "SELECT o.path_index, p.package_id, p.name, p.version, p.homepage,\n"
+        "       m.maintainer, m.email, p.as_dependency, p.is_installed\n"
+        "FROM temp.owner_paths AS o\n"
+        "CROSS JOIN directories AS d ON d.path = hemlock_dirname (o.path)\n"
+        "CROSS JOIN filelogs AS f\n"
+        "    ON f.directory_id = d.directory_id\n"
+        "   AND f.name = hemlock_basename (o.path)\n"
+        "JOIN packages AS p ON p.package_id = f.package_id\n"
+        SQL_JOIN_MAINTAINER
+        "ORDER BY o.path_index, p.name, p.version_key;\n"
+    };
+
+    if ((NULL == db) || (NULL == arena) || (NULL == owners_out) 
+     || (NULL == n_out) || ((NULL == paths) && (0 < path_count)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    *owners_out = NULL;
+    *n_out = 0;
+
+    if ((0 != db_execute (db, SQL_STAGE, log))
+     || (0 != stage_owner_paths (db, paths, path_count, log)))
+    {
+        goto db_search_file_owner_exit;
+    }
+
+    stmt = db_prepare_cached (db, STMT_SEARCH_FILE_OWNER, SQL_SELECT);
+    if (NULL == stmt) goto db_search_file_owner_exit;
+    db_log_statement (stmt, log);
+
+    memset (&row, 0, sizeof (row));
+    while (SQLITE_ROW == (retcode = sqlite3_step (stmt)))
+    {
+        if (owner_count == owner_alloc)
+        {
+            owner_alloc = (0 == owner_alloc ? 16 : (owner_alloc * 2));
+            temp = realloc (owners, owner_alloc * sizeof (db_file_owner_t));
+            if (NULL == temp)
+            {
+                errno = ENOMEM;
+                break;
+            }
+            owners = temp; temp = NULL;
+        }
+
+        row.package_id    = sqlite3_column_int (stmt, 1);
+        row.name          = (char *)sqlite3_column_text (stmt, 2);
+        row.version       = (char *)sqlite3_column_text (stmt, 3);
+        row.homepage      = (char *)sqlite3_column_text (stmt, 4);
+        row.maintainer    = (char *)sqlite3_column_text (stmt, 5);
+        row.email         = (char *)sqlite3_column_text (stmt, 6);
+        row.as_dependency = (0 != sqlite3_column_int (stmt, 7));
+        row.is_installed  = (0 != sqlite3_column_int (stmt, 8));
+
+        owners[owner_count].path_index = 
+                (size_t)sqlite3_column_int64 (stmt, 0);
+        owners[owner_count].package = pack_package (arena, &row);
+        if (NULL == owners[owner_count].package) break;
+        owner_count++;
+    }
+    (void)sqlite3_reset (stmt); stmt = NULL;
+
+    if (SQLITE_DONE != retcode)
+    {
+        if (SQLITE_ROW != retcode) 
+        {
+            fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, 
+                     sqlite3_errmsg (db));
+        }
+        retcode = -1;
+        goto db_search_file_owner_exit;
+    }
+
+    /* move the owners into the arena, one free releases everything */
+    retcode = 0;
+    if (0 < owner_count)
+    {
+        *owners_out = arena_alloc (arena, 
+                                   owner_count * sizeof (db_file_owner_t));
+        if (NULL == *owners_out)
+        {
+            retcode = -1;
+            goto db_search_file_owner_exit;
+        }
+        (void)memcpy (*owners_out, owners, 
+                      owner_count * sizeof (db_file_owner_t));
+    }
+    *n_out = owner_count;
+
+db_search_file_owner_exit:
+    free (owners); owners = NULL;
+    (void)db_execute (db, "DELETE FROM temp.owner_paths;", log);
+
+    return retcode;
+}
+
+
+db_package_t *
+db_search_package_id (sqlite3 *db, arena_t *arena, int id, FILE *log)
+{ 
+    sqlite3_stmt *stmt = NULL;
+    db_package_t **match = NULL;
+    size_t match_count = 0;
+    const size_t MATCH_MAX = 1;
+    const char *SQL_SELECT = 
+    {
+        "SELECT " SQL_PACKAGE_COLUMNS
+        "FROM packages AS p\n"
+        SQL_JOIN_MAINTAINER
+        "WHERE p.package_id = ?1;\n"
+    };
+
+    if (NULL == db)
+    {
+        errno = EINVAL;
+        return NULL;
+    }    
+    
+    stmt = db_prepare_cached (db, STMT_SEARCH_PACKAGE_ID, SQL_SELECT);
+    if ((NULL == stmt) || (SQLITE_OK != db_bind_integer (stmt, 1, id)))
+    {
+        return NULL;
+    }
+
+    match = select_packages (stmt, arena, MATCH_MAX, &match_count, log);
+
+    return ((0 == match_count) ? NULL : match[0]);
+}
+
+
+static sqlite3_stmt *
+bind_search_packages (sqlite3 *db, char *name, char *version, 
+                      db_package_filter_t filter)
+{
+    sqlite3_stmt *stmt = NULL;
+    const char *DEFAULT_VERSION = "%";
+#define SQL_SELECT_LIKE(filter) \
+        "SELECT " SQL_PACKAGE_COLUMNS \
+        "FROM packages AS p\n" \
+        SQL_JOIN_MAINTAINER \
+        "WHERE p.name    like ?1 AND\n" \
+        "      p.version like ?2\n" \
+        filter \
+        "ORDER BY p.name, p.version_key;\n"
+    const char *SQL_SELECT[PACKAGE_FILTER_COUNT] = 
+    {
+        [PACKAGE_FILTER_NONE]       = SQL_SELECT_LIKE (""),
+        [PACKAGE_FILTER_LATEST]     = SQL_SELECT_LIKE (SQL_FILTER_LATEST),
+        [PACKAGE_FILTER_UPGRADABLE] = SQL_SELECT_LIKE (SQL_FILTER_UPGRADABLE),
+    };
+#undef SQL_SELECT_LIKE
+
+    version = (char *)(NULL == version ? DEFAULT_VERSION : version);
+
+    stmt = db_prepare_cached (db, STMT_SEARCH_PACKAGES + (int)filter, 
+                              SQL_SELECT[filter]);
+    if ((NULL == stmt) 
+     || (SQLITE_OK != db_bind_text (stmt, 1, name))
+     || (SQLITE_OK != db_bind_text (stmt, 2, version)))
+    {
+        return NULL;
+    }
+
+    return stmt;
+}
+
+
+db_package_t **
+db_search_packages (sqlite3 *db, arena_t *arena, char *name, char *version, 
+                    size_t *n_out, FILE *log)
+{
+    sqlite3_stmt *stmt = NULL;
+
+    if ((NULL == db) || (NULL == name) || (NULL == n_out))
+    {
+        errno = EINVAL;
+        if (NULL != n_out) *n_out = 0;
+        return NULL;
+    }
+    *n_out = 0;
+
+    stmt = bind_search_packages (db, name, version, PACKAGE_FILTER_NONE);
+    if (NULL == stmt) return NULL;
+
+    return select_packages (stmt, arena, SIZE_MAX, n_out, log);
+}
+
+
+int
+db_package_cursor_open (db_package_cursor_t *cursor, sqlite3 *db, 
+                        char *name, char *version, 
+                        db_package_filter_t filter, FILE *log)
+{
+    sqlite3_stmt *stmt = NULL;
+
+    if ((NULL == cursor) || (NULL == db) || (NULL == name)
+     || (PACKAGE_FILTER_COUNT <= filter))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stmt = bind_search_packages (db, name, version, filter);
+    if (NULL == stmt) 
+    {
+        cursor->stmt = NULL;
+        return -1;
+    }
+
+    cursor_begin (cursor, stmt, log);
+    return 0;
+}
+
+
+static char *
+gen_match_query (const char *query)
+{
+    /* every whitespace seperated word of query becomes a quoted prefix 
+     * term, so user input never reaches the FTS5 query syntax. the terms
+     * are implicitly AND'ed together */
+    char *result = NULL;
+    char *iter = NULL;
+    size_t length = 0;
+
+    if (NULL == query) return NULL;
+
+    /* worst case every character is a doubled quote, or a new term */
+    length = (strlen (query) * 4) + 1;
+    result = malloc (length);
+    if (NULL == result)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    iter = result;
+    for (const char *c = query; '\0' != *c; )
+    {
+        /* skip the whitespace between words */
+        if (isspace ((unsigned char)*c)) 
+        {
+            c++;
+            continue;
+        }
+
+        if (iter != result) *(iter++) = ' ';
+        *(iter++) = '"';
+        for (; ('\0' != *c) && (!isspace ((unsigned char)*c)); c++)
+        {
+            if ('"' == *c) *(iter++) = '"';
+            *(iter++) = *c;
+        }
+        *(iter++) = '"';
+        *(iter++) = '*';
+    }
+    *iter = '\0';
+
+    return result;
+}
+
+
+int
+db_package_cursor_open_match (db_package_cursor_t *cursor, sqlite3 *db, 
+                              const char *query, db_package_filter_t filter,
+                              FILE *log)
+{
+    /* the query string is rewritten as FTS5 prefix terms, bound to the
+     * statement, and freed once the cursor closes */
+    sqlite3_stmt *stmt = NULL;
+    char *match = NULL;
+#define SQL_SELECT_MATCH(filter) \
+        "SELECT " SQL_PACKAGE_COLUMNS \
+        "FROM packages_fts AS f\n" \
+        "JOIN packages AS p ON p.package_id = f.rowid\n" \
+        SQL_JOIN_MAINTAINER \
+        "WHERE packages_fts MATCH ?1\n" \
+        filter \
+        "ORDER BY bm25 (packages_fts, 10.0, 1.0, 1.0);\n"
+    const char *SQL_SELECT[PACKAGE_FILTER_COUNT] = 
+    {
+        [PACKAGE_FILTER_NONE]       = SQL_SELECT_MATCH (""),
+        [PACKAGE_FILTER_LATEST]     = SQL_SELECT_MATCH (SQL_FILTER_LATEST),
+        [PACKAGE_FILTER_UPGRADABLE] = SQL_SELECT_MATCH (SQL_FILTER_UPGRADABLE),
+    };
+#undef SQL_SELECT_MATCH
+
+    if ((NULL == cursor) || (NULL == db) || (NULL == query)
+     || (PACKAGE_FILTER_COUNT <= filter))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    cursor->stmt = NULL;
+
+    match = gen_match_query (query);
+    if (NULL == match) return -1;
+
+    /* FTS5 rejects an empty expression, a query needs at least one word */
+    if ('\0' == match[0])
+    {
+        free (match);
+        errno = EINVAL;
+        return -1;
+    }
+
+    stmt = db_prepare_cached (db, STMT_SEARCH_MATCH + (int)filter, 
+                              SQL_SELECT[filter]);
+    if ((NULL == stmt)
+     || (SQLITE_OK != sqlite3_bind_text (stmt, 1, match, -1, free)))
+    {
+        /* sqlite3_bind_text frees match itself, even on failure */
+        if (NULL == stmt) free (match);
+        return -1;
+    }
+
+    cursor_begin (cursor, stmt, log);
+    return 0;
+}
+
+
+int
+db_package_cursor_next (db_package_cursor_t *cursor, db_package_t *package_out)
+{
+    /* returns 1 with a row, 0 once exhausted, -1 on error. the row borrows
+     * SQLite's column memory, valid until the next call or close */
+    int retcode;
+
+    if ((NULL == cursor) || (NULL == cursor->stmt) || (NULL == package_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    retcode = sqlite3_step (cursor->stmt);
+    if (SQLITE_ROW == retcode)
+    {
+        read_package_row (cursor, package_out);
+        return 1;
+    }
+
+    if (SQLITE_DONE != retcode)
+    {
+        fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, 
+                 sqlite3_errmsg (sqlite3_db_handle (cursor->stmt)));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void
+db_package_cursor_close (db_package_cursor_t *cursor)
+{
+    if ((NULL == cursor) || (NULL == cursor->stmt)) return;
+
+    /* hand the cached statement back */
+    (void)sqlite3_reset (cursor->stmt);
+    cursor->stmt = NULL;
+
+    return;
+}
+
+
+static void
+cursor_begin (db_package_cursor_t *cursor, sqlite3_stmt *stmt, FILE *log)
+{
+    const char *col_name = NULL;
+    int col_n = sqlite3_column_count (stmt);
+
+    if (DB_PACKAGE_COLUMN_MAX < col_n) col_n = DB_PACKAGE_COLUMN_MAX;
+
+    cursor->stmt = stmt;
+    cursor->log  = log;
+    cursor->column_count = col_n;
+
+    db_log_statement (stmt, log);
+
+    /* match every result column against the known package columns once,
+     * rows are then decoded by ordinal alone */
+    for (int i = 0; i < col_n; i++)
+    {
+        cursor->column_map[i] = COLUMN_UNKNOWN;
+
+        col_name = sqlite3_column_name (stmt, i);
+        if (NULL == col_name) continue;
+
+        for (size_t j = 0; j < PACKAGE_COLUMN_COUNT; j++)
+        {
+            if (0 == strcmp (col_name, PACKAGE_COLUMNS[j].name))
+            {
+                cursor->column_map[i] = PACKAGE_COLUMNS[j].column;
+                break;
+            }
+        }
+
+        if (COLUMN_UNKNOWN == cursor->column_map[i])
+        {
+            fprintf (stderr, "SQLite Warning: skipping bad column '%s'\n",
+                     col_name);
+        }
+    }
+
+    return;
+}
+
+
+static void
+read_package_row (db_package_cursor_t *cursor, db_package_t *package)
+{
+    db_result_t out = { .type = SQLITE_NULL, .s = NULL };
+    sqlite3_stmt *stmt = cursor->stmt;
+
+    /* define default values */
+    (void)memset (package, 0, sizeof (db_package_t));
+    package->valid = PACKAGE_INVALID;
+
+    for (int i = 0; i < cursor->column_count; i++)
+    {
+        if (COLUMN_UNKNOWN == cursor->column_map[i]) continue;
+
+        (void)db_get_column (stmt, i, &out);
+        switch (cursor->column_map[i])
+        {
+        case COLUMN_PACKAGE_ID:
+            if (SQLITE_INTEGER != out.type) break;
+            package->package_id = out.i;
+            package->valid |= PACKAGE_VALID_PACKAGE_ID;
+            break;
+
+        case COLUMN_NAME:
+            if (SQLITE_TEXT != out.type) break;
+            package->name = out.s;
+            package->valid |= PACKAGE_VALID_NAME;
+            break;
+
+        case COLUMN_VERSION:
+            if (SQLITE_TEXT != out.type) break;
+            package->version = out.s;
+            package->valid |= PACKAGE_VALID_VERSION;
+            break;
+
+        case COLUMN_HOMEPAGE:
+            if ((SQLITE_TEXT != out.type) && (SQLITE_NULL != out.type)) break;
+            package->homepage = out.s;
+            package->valid |= PACKAGE_VALID_HOMEPAGE;
+            break;
+
+        case COLUMN_MAINTAINER:
+            if ((SQLITE_TEXT != out.type) && (SQLITE_NULL != out.type)) break;
+            package->maintainer = out.s;
+            package->valid |= PACKAGE_VALID_MAINTAINER;
+            break;
+
+        case COLUMN_EMAIL:
+            if ((SQLITE_TEXT != out.type) && (SQLITE_NULL != out.type)) break;
+            package->email = out.s;
+            package->valid |= PACKAGE_VALID_EMAIL;
+            break;
+
+        case COLUMN_AS_DEPENDENCY:
+            if (SQLITE_INTEGER != out.type) break;
+            package->as_dependency = (out.i == 1 ? true : false);
+            package->valid |= PACKAGE_VALID_AS_DEPENDENCY;
+            break;
+
+        case COLUMN_IS_INSTALLED:
+            if (SQLITE_INTEGER != out.type) break;
+            package->is_installed = (out.i == 1 ? true : false);
+            package->valid |= PACKAGE_VALID_IS_INSTALLED;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+
+static db_package_t *
+pack_package (arena_t *arena, const db_package_t *src)
+{
+    db_package_t *dest = NULL;
+    char *iter = NULL;
+    size_t total = sizeof (db_package_t);
+    size_t length[5] = { 0 };
+    const char *src_field[5] = 
+    {
+        src->name, src->version, src->homepage, src->maintainer, src->email
+    };
+    const size_t FIELD_COUNT = sizeof (src_field) / sizeof (*src_field);
+
+    for (size_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (NULL != src_field[i]) length[i] = strlen (src_field[i]) + 1;
+        total += length[i];
+    }
+
+    /* the record and its strings share one allocation, so iterating a
+     * result set walks memory in order */
+    dest = arena_alloc (arena, total);
+    if (NULL == dest) return NULL;
+    *dest = *src;
+
+    char **dest_field[5] = 
+    {
+        &dest->name, &dest->version, &dest->homepage, &dest->maintainer, 
+        &dest->email
+    };
+
+    iter = (char *)(dest + 1);
+    for (size_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (NULL == src_field[i]) continue;
+
+        (void)memcpy (iter, src_field[i], length[i]);
+        *dest_field[i] = iter;
+        iter += length[i];
+    }
+
+    return dest;
+}
+
+
+static db_package_t **
+select_packages (sqlite3_stmt *stmt, arena_t *arena, size_t max_n, 
+                 size_t *n_out, FILE *log)
+{
+    int retcode = 0;
+
+    void *temp = NULL;
+    const size_t DEFAULT_ALLOC = 16;
+    size_t result_count = 0;
+    size_t result_alloc = 0;
+    db_package_t **index = NULL;
+    db_package_t **result = NULL;
+
+    db_package_cursor_t cursor;
+    db_package_t row;
+
+    if ((NULL == stmt) || (NULL == arena) || (0 == max_n) || (NULL == n_out))
+    {
+        errno = EINVAL;
+        (void)sqlite3_reset (stmt);
+        goto select_package_exit;
+    }
+
+    cursor_begin (&cursor, stmt, log);
+
+    while ((result_count < max_n)
+        && (1 == (retcode = db_package_cursor_next (&cursor, &row))))
+    {
+        /* ensure that the index is large enough */
+        if (result_count == result_alloc)
+        {
+            result_alloc = (0 == result_alloc ? DEFAULT_ALLOC 
+                                              : (result_alloc * 2));
+            temp = realloc (index, result_alloc * sizeof (db_package_t *));
+            if (NULL == temp)
+            {
+                retcode = -1;
+                errno = ENOMEM;
+                break;
+            }
+            index = temp;
+        }
+
+        /* copy the borrowed row out of SQLite's memory */
+        index[result_count] = pack_package (arena, &row);
+        if (NULL == index[result_count])
+        {
+            retcode = -1;
+            break;
+        }
+
+        /* increment */
+        result_count++;
+    }
+
+    db_package_cursor_close (&cursor);
+
+    /* move the index into the arena too, one free releases everything.
+     * on failure, the rows packed so far stay in the arena until then */
+    if ((-1 != retcode) && (0 != result_count))
+    {
+        result = arena_alloc (arena, result_count * sizeof (db_package_t *));
+        if (NULL != result) 
+        {
+            (void)memcpy (result, index, 
+                          result_count * sizeof (db_package_t *));
+        }
+    }
+    if (NULL == result) result_count = 0;
+
+    free (index); index = NULL;
+
+select_package_exit:
     /* return values */
     *n_out = result_count;
     return result;
@@ -9,7 +9,9 @@ extern "C" {
 #endif
 /* code start */
 
+#include "arena.h"
 #include "database_core.h"      /* not necessary */
+#include "string_utils.h"
 #include <sqlite3.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -58,14 +60,76 @@ typedef struct
 } db_filelog_t;
 
 
+/* a package logging one of the paths given to db_search_file_owner () */
+typedef struct
+{
+    size_t path_index;
+    db_package_t *package;
+} db_file_owner_t;
+
+
+/* result columns a package cursor can decode */
+#define DB_PACKAGE_COLUMN_MAX 16
+
+/* which versions of each package name a search keeps */
+typedef enum
+{
+    PACKAGE_FILTER_NONE,        /* every version */
+    PACKAGE_FILTER_LATEST,      /* only the newest version */
+    PACKAGE_FILTER_UPGRADABLE,  /* installed versions with a newer one */
+    PACKAGE_FILTER_COUNT
+} db_package_filter_t;
+
+/* a package query in progress, see db_package_cursor_open ().
+ * each cursor borrows its connection's cached statement, so only one
+ * cursor per connection may be open at a time */
+typedef struct
+{
+    sqlite3_stmt *stmt;
+    FILE *log;
+    int column_count;
+    int column_map[DB_PACKAGE_COLUMN_MAX];
+} db_package_cursor_t;
+
+
 int db_create_tables (sqlite3 *db, FILE *log);
 int db_insert_package (sqlite3 *db, db_package_t *package, FILE *log);
+int db_upsert_package (sqlite3 *db, db_package_t *package, FILE *log);
 int db_update_package (sqlite3 *db, db_package_t *package, FILE *log);
-db_package_t *db_search_packages (sqlite3 *db, char *name, char *version, 
-                                  size_t *n_out, FILE *log);
-db_package_t *db_search_package_id (sqlite3 *db, int id, FILE *log);
+uint32_t db_package_diff (const db_package_t *current, db_package_t *package);
+int db_insert_filelog (sqlite3 *db, int package_id, const char *path, 
+                       FILE *log);
+int db_insert_dependency (sqlite3 *db, int dependant_id, int package_id, 
+                          FILE *log);
+int db_resolve_package (sqlite3 *db, const char *name, int *package_id_out, 
+                        FILE *log);
+int db_find_package (sqlite3 *db, const char *name, const char *version, 
+                     int *package_id_out, FILE *log);
+int db_remove_package (sqlite3 *db, int package_id, bool cascade, bool force,
+                       size_t *removed_out, FILE *log);
+int db_clear_filelogs (sqlite3 *db, int package_id, FILE *log);
+int db_clear_requirements (sqlite3 *db, int package_id, FILE *log);
+db_package_t **db_search_packages (sqlite3 *db, arena_t *arena, char *name, 
+                                   char *version, size_t *n_out, FILE *log);
+db_package_t *db_search_package_id (sqlite3 *db, arena_t *arena, int id, 
+                                    FILE *log);
+int db_search_file_owner (sqlite3 *db, arena_t *arena, char **paths, 
+                          size_t path_count, db_file_owner_t **owners_out, 
+                          size_t *n_out, FILE *log);
+
+int db_package_cursor_open (db_package_cursor_t *cursor, sqlite3 *db, 
+                            char *name, char *version, 
+                            db_package_filter_t filter, FILE *log);
+int db_package_cursor_open_match (db_package_cursor_t *cursor, sqlite3 *db, 
+                                  const char *query, 
+                                  db_package_filter_t filter, FILE *log);
+int db_package_cursor_next (db_package_cursor_t *cursor, 
+                            db_package_t *package_out);
+void db_package_cursor_close (db_package_cursor_t *cursor);
 
 char *db_human_readable_package (db_package_t *package);
+int db_append_readable_package (string_builder_t *builder, 
+                                db_package_t *package);
 void db_free_package (db_package_t *package);
 
 /* code end */
@@ -9,10 +9,79 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+#include "trace.h"
+#include "filepath.h"
 #include "string_utils.h"
+#include "version.h"
+
+
+/* connection tuning, applied by db_open (). safe keeps sqlite's own
+ * defaults, fast trades durability of the last commits on power loss for
+ * fewer syncs, bulk drops crash safety entirely for imports that can be 
+ * rerun. a pooled connection moves between profiles, and WAL is stored in
+ * the file, so every profile sets every pragma and names its journal */
+typedef struct
+{
+    const char *name;
+    const char *SQL;
+    const char *journal_mode;
+} db_profile_t;
+
+static const db_profile_t PROFILES[] =
+{
+    { "safe", 
+      "PRAGMA synchronous = FULL;\n"
+      "PRAGMA cache_size = -2000;\n"          /* sqlite's default */
+      "PRAGMA mmap_size = 0;\n"
+      "PRAGMA temp_store = DEFAULT;\n",
+      "DELETE" },
+    { "fast", 
+      "PRAGMA synchronous = NORMAL;\n"
+      "PRAGMA cache_size = -65536;\n"         /* 64MiB */
+      "PRAGMA mmap_size = 268435456;\n"       /* 256MiB */
+      "PRAGMA temp_store = MEMORY;\n",
+      "WAL" },
+    { "bulk", 
+      "PRAGMA synchronous = OFF;\n"
+      "PRAGMA cache_size = -262144;\n"        /* 256MiB */
+      "PRAGMA mmap_size = 0;\n"
+      "PRAGMA temp_store = MEMORY;\n",
+      "MEMORY" },
+};
+#define PROFILE_COUNT (sizeof (PROFILES) / sizeof (*PROFILES))
+
+static const db_profile_t *s_profile = PROFILES;
+
+/* per-connection state, kept in a short list since hemlock rarely holds
+ * more than one connection at a time */
+typedef struct db_connection
+{
+    sqlite3 *db;
+    sqlite3_stmt *stmt_cache[DB_STMT_CACHE_SIZE];
+    int refs;
+    int depth;      /* open transactions, nested ones are savepoints */
+    const db_profile_t *profile;    /* last applied, NULL when unknown */
+    struct db_connection *next;
+} db_connection_t;
+
+static db_connection_t *s_connection_list = NULL;
+
+/* when set, db_close () parks connections for the next db_open () of the
+ * same file, see db_retain_connections () */
+static bool s_retain_connections = false;
 
 
 static void log_sql_error (int errcode, const char *errmsg);
+static db_connection_t *connection_find (sqlite3 *db);
+static db_connection_t *connection_attach (sqlite3 *db);
+static void connection_detach (sqlite3 *db);
+static sqlite3 *connection_reuse (const char *filename);
+static int apply_profile (db_connection_t *conn, bool strict);
+static bool connection_release (sqlite3 *db);
+static sqlite3 *open_connection (const char *filename);
+static int connection_trace (unsigned type, void *context, void *p, void *x);
 
 
 static void
@@ -23,12 +92,288 @@ log_sql_error (int errcode, const char *errmsg)
 }
 
 
-sqlite3 *
-db_open (const char *filename)
+static db_connection_t *
+connection_find (sqlite3 *db)
+{
+    for (db_connection_t *iter = s_connection_list; NULL != iter; 
+         iter = iter->next)
+    {
+        if (db == iter->db) return iter;
+    }
+
+    return NULL;
+}
+
+
+static db_connection_t *
+connection_attach (sqlite3 *db)
+{
+    db_connection_t *conn = calloc (1, sizeof (db_connection_t));
+    if (NULL == conn)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    conn->db   = db;
+    conn->refs = 1;
+    conn->next = s_connection_list;
+    s_connection_list = conn;
+
+    return conn;
+}
+
+
+static void
+connection_detach (sqlite3 *db)
+{
+    db_connection_t **link = &s_connection_list;
+    db_connection_t *conn = NULL;
+
+    /* unlink the connection from the list */
+    while ((NULL != *link) && (db != (*link)->db)) link = &(*link)->next;
+    if (NULL == *link) return;
+    conn  = *link;
+    *link = conn->next;
+
+    /* release every cached statement */
+    for (size_t i = 0; i < DB_STMT_CACHE_SIZE; i++)
+    {
+        (void)sqlite3_finalize (conn->stmt_cache[i]); 
+        conn->stmt_cache[i] = NULL;
+    }
+
+    free (conn);
+    return;
+}
+
+
+static sqlite3 *
+connection_reuse (const char *filename)
+{
+    /* find an open connection to filename, parked or still in use. paths
+     * are compared in the form sqlite reports them, so relative names 
+     * match too */
+    sqlite3_vfs *vfs = sqlite3_vfs_find (NULL);
+    char *full_path = NULL;
+    const char *conn_path = NULL;
+    sqlite3 *db = NULL;
+
+    if ((NULL == vfs) || (NULL == s_connection_list)) return NULL;
+
+    full_path = malloc (vfs->mxPathname + 1);
+    if (NULL == full_path) return NULL;
+
+    if (SQLITE_OK == vfs->xFullPathname (vfs, filename, vfs->mxPathname + 1, 
+                                         full_path))
+    {
+        for (db_connection_t *iter = s_connection_list; NULL != iter; 
+             iter = iter->next)
+        {
+            conn_path = sqlite3_db_filename (iter->db, "main");
+            if ((NULL != conn_path) 
+             && (0 == strcmp (conn_path, full_path)))
+            {
+                iter->refs++;
+                db = iter->db;
+                break;
+            }
+        }
+    }
+
+    free (full_path); full_path = NULL;
+    return db;
+}
+
+
+static bool
+connection_release (sqlite3 *db)
+{
+    /* parks the connection instead of closing it. returns false when the
+     * connection cannot be kept, and should be closed */
+    db_connection_t *conn = connection_find (db);
+    const char *path = sqlite3_db_filename (db, "main");
+
+    if ((!s_retain_connections) || (NULL == conn) 
+     || (NULL == path) || ('\0' == path[0]))
+    {
+        return false;
+    }
+
+    /* still in use further up, by a batch for example */
+    if (1 < conn->refs)
+    {
+        conn->refs--;
+        return true;
+    }
+
+    /* leave nothing behind for the next user, an abandoned transaction
+     * or a half stepped statement would pin the old snapshot */
+    for (size_t i = 0; i < DB_STMT_CACHE_SIZE; i++)
+    {
+        if (NULL != conn->stmt_cache[i]) (void)sqlite3_reset (conn->stmt_cache[i]);
+    }
+    if (0 == sqlite3_get_autocommit (db))
+    {
+        (void)sqlite3_exec (db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+
+    conn->refs  = 0;
+    conn->depth = 0;
+    return true;
+}
+
+
+int
+db_select_profile (const char *name)
+{
+    /* picks the tuning for connections opened from now on. NULL falls
+     * back to $HEMLOCK_PROFILE, then to safe. returns -1 for an unknown
+     * name, leaving the profile unchanged */
+    if (NULL == name) name = getenv ("HEMLOCK_PROFILE");
+    if ((NULL == name) || ('\0' == name[0])) name = PROFILES[0].name;
+
+    for (size_t i = 0; i < PROFILE_COUNT; i++)
+    {
+        if (0 == strcmp (name, PROFILES[i].name))
+        {
+            s_profile = PROFILES + i;
+            return 0;
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+
+const char *
+db_profile_name (void)
+{
+    /* the profile db_select_profile () settled on */
+    return s_profile->name;
+}
+
+
+static int
+apply_profile (db_connection_t *conn, bool strict)
+{
+    /* journal_mode goes last, it is the one pragma that can fail, or keep
+     * the old mode, when another connection has the file open. a new
+     * connection then keeps the file's current journal, which is safe
+     * either way, so failures are only reported. a pooled connection
+     * handed to a command that asked for another profile is strict, it 
+     * fails instead of silently running with the last user's tuning */
+    const char *level = (strict ? "error" : "warning");
+    char *errmsg = NULL;
+    char sql[64];
+    const char *mode = NULL;
+    const char *filename = NULL;
+    sqlite3_stmt *stmt = NULL;
+    int retcode;
+    int status = 0;
+
+    if (s_profile == conn->profile) return 0;
+    conn->profile = NULL;
+
+    if (SQLITE_OK != sqlite3_exec (conn->db, s_profile->SQL, NULL, NULL, 
+                                   &errmsg))
+    {
+        fprintf (stderr, "%s: cannot apply the %s profile: %s\n", level,
+                 s_profile->name, errmsg);
+        sqlite3_free (errmsg); errmsg = NULL;
+        status = -1;
+    }
+
+    (void)snprintf (sql, sizeof (sql), "PRAGMA journal_mode = %s;", 
+                    s_profile->journal_mode);
+    retcode = sqlite3_prepare_v2 (conn->db, sql, -1, &stmt, NULL);
+    if (SQLITE_OK == retcode) retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) 
+    {
+        mode = (const char *)sqlite3_column_text (stmt, 0);
+
+        /* memory databases only ever journal in memory */
+        filename = sqlite3_db_filename (conn->db, "main");
+        if ((NULL == filename) || ('\0' == filename[0])
+         || ((NULL != mode) 
+          && (0 == sqlite3_stricmp (mode, s_profile->journal_mode))))
+        {
+            retcode = SQLITE_OK;
+        }
+    }
+
+    if (SQLITE_ROW == retcode)
+    {
+        fprintf (stderr, "%s: the %s profile keeps the %s journal, "
+                 "not %s\n", level, s_profile->name, 
+                 (NULL != mode) ? mode : "", s_profile->journal_mode);
+        status = -1;
+    }
+    else if (SQLITE_OK != retcode)
+    {
+        fprintf (stderr, "%s: cannot set the %s journal for the %s "
+                 "profile: %s\n", level, s_profile->journal_mode, 
+                 s_profile->name, sqlite3_errmsg (conn->db));
+        status = -1;
+    }
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+
+    /* a failed switch leaves the tuning unknown, the next user retries */
+    if ((0 == status) || (!strict)) conn->profile = s_profile;
+    return (strict ? status : 0);
+}
+
+
+void
+db_retain_connections (bool retain)
+{
+    /* long running processes keep their connections, along with their
+     * statement caches and page caches, between uses. turning it off
+     * closes every idle connection */
+    db_connection_t *iter = s_connection_list;
+    db_connection_t *next = NULL;
+
+    s_retain_connections = retain;
+    if (retain) return;
+
+    while (NULL != iter)
+    {
+        next = iter->next;
+        if (0 == iter->refs) db_close (iter->db);
+        iter = next;
+    }
+
+    return;
+}
+
+
+static sqlite3 *
+open_connection (const char *filename)
 {
     /* try to open filename as a sqlite3 database */
     sqlite3 *db = NULL;
-    int retcode = sqlite3_open (filename, &db);
+    db_connection_t *conn = NULL;
+    int retcode;
+
+    /* reuse a parked connection when there is one, tuned for the profile
+     * this command selected */
+    if (s_retain_connections && (NULL != filename))
+    {
+        db = connection_reuse (filename);
+        if (NULL != db)
+        {
+            conn = connection_find (db);
+            if (0 == apply_profile (conn, true)) return db;
+
+            /* hand the reference connection_reuse () took back */
+            conn->refs--;
+            return NULL;
+        }
+    }
+
+    retcode = sqlite3_open_v2 (filename, &db, 
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, stats_vfs ());
     if (SQLITE_OK != retcode)   /* if the database cannot be opened */
     {
         /* throw an error */
@@ -43,17 +388,78 @@ db_open (const char *filename)
         return NULL;
     }
 
+    /* create the statement cache for the connection */
+    conn = connection_attach (db);
+    if (NULL == conn)
+    {
+        db_close (db); db = NULL;
+        return NULL;
+    }
+
+    /* the schema and queries order versions with hemlock_version_key (),
+     * and split file log paths with hemlock_dirname () and _basename () */
+    if ((0 != version_register (db)) || (0 != filepath_register (db)))
+    {
+        db_close (db); db = NULL;
+        return NULL;
+    }
+
+    (void)apply_profile (conn, false);
+
     /* return the database pointer */
     return db;
 }
 
 
+static int
+connection_trace (unsigned type, void *context, void *p, void *x)
+{
+    /* a connection has one trace hook, shared by --stats and --trace */
+    (void)context;
+
+    stats_trace (type, p, x);
+    trace_record (type, p, x);
+    return 0;
+}
+
+
+sqlite3 *
+db_open (const char *filename)
+{
+    sqlite3 *db = NULL;
+    stats_phase_t phase = stats_phase (STATS_PHASE_OPEN);
+    unsigned mask = 0;
+
+    db = open_connection (filename);
+    if (NULL != db)
+    {
+        /* a mask of 0 removes the hook a pooled connection may still have */
+        stats_attach (db);
+        mask = stats_trace_mask () | trace_mask ();
+        (void)sqlite3_trace_v2 (db, mask, ((0 != mask) ? connection_trace 
+                                                      : NULL), NULL);
+    }
+
+    (void)stats_phase (phase);
+    return db;
+}
+
+
 void
 db_close (sqlite3 *db)
 {
     /* guard against null */
     if (NULL == db) return;
 
+    stats_detach (db);
+
+    /* parked connections stay open */
+    if (connection_release (db)) return;
+
+    /* release the statement cache. virtual tables own statements of their
+     * own, so only the cached ones are ours to finalize */
+    connection_detach (db);
+
     /* purpetually try to close the database, until it succeeds */
     while (SQLITE_OK != sqlite3_close (db)) {}
 
@@ -91,6 +497,259 @@ db_execute (sqlite3 *db, const char *SQL_SCRIPT, FILE *log)
 }
 
 
+int
+db_pragma_integer (sqlite3 *db, const char *PRAGMA, int *value_out)
+{
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+    string_builder_t builder;
+    char *statement = NULL;
+
+    /* NULL deref guard */
+    if ((NULL == db) || (NULL == PRAGMA) || (NULL == value_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    string_builder_init (&builder);
+    (void)string_builder_append (&builder, "PRAGMA ");
+    (void)string_builder_append (&builder, PRAGMA);
+    (void)string_builder_append_char (&builder, ';');
+
+    statement = string_builder_finish (&builder);
+    if (NULL == statement) return -1;
+
+    retcode = sqlite3_prepare_v2 (db, statement, -1, &stmt, NULL);
+    free (statement); statement = NULL;
+    if (SQLITE_OK != retcode)
+    {
+        log_sql_error (retcode, sqlite3_errmsg (db));
+        return -1;
+    }
+
+    /* read the single integer the pragma reports */
+    retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) *value_out = sqlite3_column_int (stmt, 0);
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+
+    if (SQLITE_ROW != retcode)
+    {
+        log_sql_error (retcode, sqlite3_errmsg (db));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int
+db_transaction_begin (sqlite3 *db, FILE *log)
+{
+    /* inside a transaction this opens a savepoint instead, so callers can
+     * be grouped into a larger transaction without knowing it */
+    int retcode;
+    db_connection_t *conn = connection_find (db);
+
+    if ((NULL != conn) && (0 < conn->depth))
+    {
+        retcode = db_execute (db, "SAVEPOINT hemlock;", log);
+    }
+    else
+    {
+        /* take the write lock up front, so the transaction cannot deadlock 
+         * against another writer half way through */
+        retcode = db_execute (db, "BEGIN IMMEDIATE;", log);
+    }
+
+    if ((0 == retcode) && (NULL != conn)) conn->depth++;
+    return retcode;
+}
+
+
+int
+db_transaction_commit (sqlite3 *db, FILE *log)
+{
+    /* a failed commit leaves the transaction open for a rollback */
+    int retcode;
+    db_connection_t *conn = connection_find (db);
+
+    if ((NULL != conn) && (1 < conn->depth))
+    {
+        retcode = db_execute (db, "RELEASE hemlock;", log);
+    }
+    else
+    {
+        retcode = db_execute (db, "COMMIT;", log);
+    }
+
+    if ((0 == retcode) && (NULL != conn) && (0 < conn->depth)) conn->depth--;
+    return retcode;
+}
+
+
+int
+db_transaction_rollback (sqlite3 *db, FILE *log)
+{
+    /* nested, only the work since the matching begin is undone */
+    int retcode;
+    db_connection_t *conn = connection_find (db);
+
+    if ((NULL != conn) && (1 < conn->depth))
+    {
+        retcode = db_execute (db, "ROLLBACK TO hemlock; RELEASE hemlock;", 
+                              log);
+    }
+    else
+    {
+        retcode = db_execute (db, "ROLLBACK;", log);
+    }
+
+    if ((NULL != conn) && (0 < conn->depth)) conn->depth--;
+    return retcode;
+}
+
+
+sqlite3_stmt *
+db_prepare (sqlite3 *db, const char *SQL)
+{
+    /* compiles a one-off statement, the caller finalizes it. statements
+     * that run repeatedly belong in db_prepare_cached () */
+    int retcode;
+    sqlite3_stmt *stmt = NULL;
+
+    /* NULL deref guard */
+    if ((NULL == db) || (NULL == SQL))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    retcode = sqlite3_prepare_v2 (db, SQL, -1, &stmt, NULL);
+    if ((SQLITE_OK != retcode) || (NULL == stmt))
+    {
+        log_sql_error (retcode, sqlite3_errmsg (db));
+        (void)sqlite3_finalize (stmt); stmt = NULL;
+        return NULL;
+    }
+
+    return stmt;
+}
+
+
+sqlite3_stmt *
+db_prepare_cached (sqlite3 *db, int key, const char *SQL)
+{
+    int retcode;
+    sqlite3_stmt **slot = NULL;
+    db_connection_t *conn = NULL;
+
+    /* NULL deref guard */
+    if ((NULL == db) || (NULL == SQL) || (0 > key) 
+     || (DB_STMT_CACHE_SIZE <= key))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    conn = connection_find (db);
+    if (NULL == conn)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    slot = conn->stmt_cache + key;
+
+    /* reuse the cached statement, resetting it for the new caller */
+    if (NULL != *slot)
+    {
+        (void)sqlite3_reset (*slot);
+        (void)sqlite3_clear_bindings (*slot);
+        return *slot;
+    }
+
+    /* otherwise compile the statement once, and keep it */
+    retcode = sqlite3_prepare_v3 (db, SQL, -1, SQLITE_PREPARE_PERSISTENT, 
+                                  slot, NULL);
+    if ((SQLITE_OK != retcode) || (NULL == *slot))
+    {
+        log_sql_error (retcode, sqlite3_errmsg (db));
+        (void)sqlite3_finalize (*slot); *slot = NULL;
+        return NULL;
+    }
+
+    return *slot;
+}
+
+
+int
+db_step_done (sqlite3_stmt *stmt, FILE *log)
+{
+    int retcode;
+
+    /* NULL deref guard */
+    if (NULL == stmt)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    db_log_statement (stmt, log);
+
+    /* run the statement to completion, discarding any rows */
+    while (SQLITE_ROW == (retcode = sqlite3_step (stmt))) {}
+    (void)sqlite3_reset (stmt);
+
+    if (SQLITE_DONE != retcode)   /* handle sql errors */
+    {
+        log_sql_error (retcode, sqlite3_errmsg (sqlite3_db_handle (stmt)));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void
+db_log_statement (sqlite3_stmt *stmt, FILE *log)
+{
+    char *expanded = NULL;
+
+    if ((NULL == stmt) || (NULL == log)) return;
+
+    /* log the statement with its bound parameters filled in */
+    expanded = sqlite3_expanded_sql (stmt);
+    fprintf (log, "%s\n", (NULL != expanded ? expanded : sqlite3_sql (stmt)));
+    sqlite3_free (expanded); expanded = NULL;
+
+    return;
+}
+
+
+int
+db_bind_text (sqlite3_stmt *stmt, int i, const char *data)
+{
+    if (NULL == data) return sqlite3_bind_null (stmt, i);
+
+    /* the caller keeps data alive until the statement is stepped */
+    return sqlite3_bind_text (stmt, i, data, -1, SQLITE_STATIC);
+}
+
+
+int
+db_bind_boolean (sqlite3_stmt *stmt, int i, bool data)
+{
+    return sqlite3_bind_int (stmt, i, ((data) ? 1 : 0));
+}
+
+
+int
+db_bind_integer (sqlite3_stmt *stmt, int i, int data)
+{
+    return sqlite3_bind_int (stmt, i, data);
+}
+
+
 char *
 db_escape_null (void)
 {
@@ -101,13 +760,12 @@ db_escape_null (void)
 char *
 db_escape_text (char *data)
 {
-    if (NULL == data) return db_escape_null ();
+    string_builder_t builder;
 
-    char *escaped = string_replace (data, "'", "''");
-    char *quoted  = string_quote (escaped, "'");
+    string_builder_init (&builder);
+    (void)string_builder_append_escaped (&builder, data, '\'');
 
-    free (escaped);
-    return quoted;
+    return string_builder_finish (&builder);
 }
 
 
@@ -28,10 +28,30 @@ typedef struct
 } db_result_t;
 
 
+/* number of prepared statements each connection can keep cached */
+#define DB_STMT_CACHE_SIZE 32
+
+
 sqlite3 *db_open (const char *filename);
 void db_close (sqlite3 *db);
+void db_retain_connections (bool retain);
+int db_select_profile (const char *name);
+const char *db_profile_name (void);
 
 int db_execute (sqlite3 *db, const char *SQL_SCRIPT, FILE *log);
+int db_pragma_integer (sqlite3 *db, const char *PRAGMA, int *value_out);
+int db_transaction_begin (sqlite3 *db, FILE *log);
+int db_transaction_commit (sqlite3 *db, FILE *log);
+int db_transaction_rollback (sqlite3 *db, FILE *log);
+
+sqlite3_stmt *db_prepare (sqlite3 *db, const char *SQL);
+sqlite3_stmt *db_prepare_cached (sqlite3 *db, int key, const char *SQL);
+int db_step_done (sqlite3_stmt *stmt, FILE *log);
+void db_log_statement (sqlite3_stmt *stmt, FILE *log);
+
+int db_bind_text (sqlite3_stmt *stmt, int i, const char *data);
+int db_bind_boolean (sqlite3_stmt *stmt, int i, bool data);
+int db_bind_integer (sqlite3_stmt *stmt, int i, int data);
 
 char *db_escape_null (void);
 char *db_escape_text (char *data);
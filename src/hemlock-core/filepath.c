@@ -0,0 +1,86 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "filepath.h"
+
+#include <sqlite3.h>
+#include <stddef.h>
+#include <string.h>
+
+
+static void sql_dirname (sqlite3_context *context, int argc, 
+                         sqlite3_value **argv);
+static void sql_basename (sqlite3_context *context, int argc, 
+                          sqlite3_value **argv);
+
+
+size_t
+filepath_dirname_length (const char *path)
+{
+    const char *slash = strrchr (path, '/');
+
+    return ((NULL == slash) ? 0 : (size_t)(slash - path) + 1);
+}
+
+
+static void
+sql_dirname (sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    const char *path = NULL;
+
+    (void)argc;
+
+    path = (const char *)sqlite3_value_text (argv[0]);
+    if (NULL == path)
+    {
+        sqlite3_result_null (context);
+        return;
+    }
+
+    sqlite3_result_text (context, path, (int)filepath_dirname_length (path), 
+                         SQLITE_TRANSIENT);
+}
+
+
+static void
+sql_basename (sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    const char *path = NULL;
+
+    (void)argc;
+
+    path = (const char *)sqlite3_value_text (argv[0]);
+    if (NULL == path)
+    {
+        sqlite3_result_null (context);
+        return;
+    }
+
+    sqlite3_result_text (context, path + filepath_dirname_length (path), -1, 
+                         SQLITE_TRANSIENT);
+}
+
+
+int
+filepath_register (sqlite3 *db)
+{
+    /* hemlock_dirname (PATH) and hemlock_basename (PATH), for migrating
+     * and looking up file logs */
+    const int FLAGS = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+
+    if ((SQLITE_OK != sqlite3_create_function (db, "hemlock_dirname", 1, 
+                                               FLAGS, NULL, sql_dirname, 
+                                               NULL, NULL))
+     || (SQLITE_OK != sqlite3_create_function (db, "hemlock_basename", 1, 
+                                               FLAGS, NULL, sql_basename, 
+                                               NULL, NULL)))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* end of file */
@@ -0,0 +1,27 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_FILEPATH_HEADER
+#define HEMLOCK_FILEPATH_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+
+/* file logs keep a path as its directory, up to and including the last
+ * '/', and the name after it. the two concatenate back to the path, so
+ * "/usr/bin/ls" is "/usr/bin/" and "ls", "ls" is "" and "ls" */
+size_t filepath_dirname_length (const char *path);
+int filepath_register (sqlite3 *db);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
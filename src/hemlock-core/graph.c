@@ -0,0 +1,441 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "graph.h"
+
+#include "database_core.h"
+#include <errno.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* depth first search states */
+enum
+{
+    NODE_UNVISITED,
+    NODE_ACTIVE,
+    NODE_DONE,
+};
+
+
+static int count_rows (sqlite3 *db, const char *SQL, size_t *n_out, 
+                       FILE *log);
+static int load_nodes (sqlite3 *db, graph_t *graph, FILE *log);
+static int load_edges (sqlite3 *db, graph_t *graph, uint32_t **from_out, 
+                       uint32_t **to_out, FILE *log);
+static uint32_t *build_rows (size_t node_count, size_t edge_count,
+                             const uint32_t *from, const uint32_t *to, 
+                             uint32_t **offset_out);
+static void push_dependants (const graph_t *graph, uint32_t node, 
+                             unsigned char *seen, uint32_t *queue, 
+                             size_t *count);
+
+
+static int
+count_rows (sqlite3 *db, const char *SQL, size_t *n_out, FILE *log)
+{
+    sqlite3_stmt *stmt = NULL;
+    int retcode;
+
+    retcode = sqlite3_prepare_v2 (db, SQL, -1, &stmt, NULL);
+    if (SQLITE_OK != retcode)
+    {
+        fprintf (stderr, "SQLite3 Error: %d: %s\n", retcode, 
+                 sqlite3_errmsg (db));
+        return -1;
+    }
+
+    db_log_statement (stmt, log);
+    retcode = sqlite3_step (stmt);
+    if (SQLITE_ROW == retcode) *n_out = (size_t)sqlite3_column_int64 (stmt, 0);
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+
+    return ((SQLITE_ROW == retcode) ? 0 : -1);
+}
+
+
+static int
+load_nodes (sqlite3 *db, graph_t *graph, FILE *log)
+{
+    sqlite3_stmt *stmt = NULL;
+    size_t count = 0;
+    int retcode;
+    const char *SQL_COUNT  = "SELECT count(*) FROM packages;";
+    const char *SQL_SELECT = 
+    {
+        "SELECT package_id\n"
+        "FROM packages\n"
+        "ORDER BY package_id;\n"
+    };
+
+    if (0 != count_rows (db, SQL_COUNT, &graph->node_count, log)) return -1;
+    if (UINT32_MAX <= graph->node_count)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    graph->package_id = malloc ((graph->node_count + 1) * sizeof (int));
+    if (NULL == graph->package_id)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    retcode = sqlite3_prepare_v2 (db, SQL_SELECT, -1, &stmt, NULL);
+    if (SQLITE_OK != retcode) return -1;
+
+    /* an empty table never steps and still loads completely */
+    retcode = SQLITE_DONE;
+
+    /* the rowid order doubles as the node numbering */
+    db_log_statement (stmt, log);
+    while ((count < graph->node_count) 
+        && (SQLITE_ROW == (retcode = sqlite3_step (stmt))))
+    {
+        graph->package_id[count++] = sqlite3_column_int (stmt, 0);
+    }
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+    if ((SQLITE_ROW != retcode) && (SQLITE_DONE != retcode)) return -1;
+
+    graph->node_count = count;
+    return 0;
+}
+
+
+static int
+load_edges (sqlite3 *db, graph_t *graph, uint32_t **from_out, 
+            uint32_t **to_out, FILE *log)
+{
+    sqlite3_stmt *stmt = NULL;
+    size_t alloc = 0, count = 0;
+    uint32_t from, to;
+    int retcode;
+    const char *SQL_COUNT  = "SELECT count(*) FROM dependencies;";
+    const char *SQL_SELECT = 
+    {
+        "SELECT dependant_id, package_id\n"
+        "FROM dependencies;\n"
+    };
+
+    if (0 != count_rows (db, SQL_COUNT, &alloc, log)) return -1;
+    if (UINT32_MAX <= alloc)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    *from_out = malloc ((alloc + 1) * sizeof (uint32_t));
+    *to_out   = malloc ((alloc + 1) * sizeof (uint32_t));
+    if ((NULL == *from_out) || (NULL == *to_out))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    retcode = sqlite3_prepare_v2 (db, SQL_SELECT, -1, &stmt, NULL);
+    if (SQLITE_OK != retcode) return -1;
+
+    /* a catalog without any edges is an empty, valid graph */
+    retcode = SQLITE_DONE;
+    db_log_statement (stmt, log);
+    while ((count < alloc) && (SQLITE_ROW == (retcode = sqlite3_step (stmt))))
+    {
+        from = graph_node (graph, sqlite3_column_int (stmt, 0));
+        to   = graph_node (graph, sqlite3_column_int (stmt, 1));
+
+        /* edges to missing packages cannot be walked, drop them */
+        if ((GRAPH_NODE_NONE == from) || (GRAPH_NODE_NONE == to)) continue;
+
+        (*from_out)[count] = from;
+        (*to_out)[count]   = to;
+        count++;
+    }
+    (void)sqlite3_finalize (stmt); stmt = NULL;
+    if ((SQLITE_ROW != retcode) && (SQLITE_DONE != retcode)) return -1;
+
+    graph->edge_count = count;
+    return 0;
+}
+
+
+static uint32_t *
+build_rows (size_t node_count, size_t edge_count, const uint32_t *from, 
+            const uint32_t *to, uint32_t **offset_out)
+{
+    uint32_t *offset = NULL;
+    uint32_t *cursor = NULL;
+    uint32_t *edge = NULL;
+
+    offset = calloc (node_count + 1, sizeof (uint32_t));
+    cursor = malloc ((node_count + 1) * sizeof (uint32_t));
+    edge   = malloc ((edge_count + 1) * sizeof (uint32_t));
+    if ((NULL == offset) || (NULL == cursor) || (NULL == edge))
+    {
+        free (offset);
+        free (cursor);
+        free (edge);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* count the edges of every node, then prefix sum into offsets */
+    for (size_t i = 0; i < edge_count; i++) offset[from[i] + 1]++;
+    for (size_t i = 0; i < node_count; i++) offset[i + 1] += offset[i];
+
+    /* place every edge in its row */
+    (void)memcpy (cursor, offset, (node_count + 1) * sizeof (uint32_t));
+    for (size_t i = 0; i < edge_count; i++) edge[cursor[from[i]]++] = to[i];
+
+    free (cursor); cursor = NULL;
+
+    *offset_out = offset;
+    return edge;
+}
+
+
+int
+graph_load (sqlite3 *db, graph_t *graph_out, FILE *log)
+{
+    int retcode = -1;
+    uint32_t *from = NULL, *to = NULL;
+
+    if ((NULL == db) || (NULL == graph_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    (void)memset (graph_out, 0, sizeof (graph_t));
+
+    /* one scan of each table, every walk after that stays in memory */
+    if ((0 != load_nodes (db, graph_out, log))
+     || (0 != load_edges (db, graph_out, &from, &to, log)))
+    {
+        goto graph_load_exit;
+    }
+
+    graph_out->dependency = build_rows (graph_out->node_count, 
+                                        graph_out->edge_count, from, to, 
+                                        &graph_out->dependency_offset);
+    graph_out->dependant  = build_rows (graph_out->node_count, 
+                                        graph_out->edge_count, to, from, 
+                                        &graph_out->dependant_offset);
+    if ((NULL == graph_out->dependency) || (NULL == graph_out->dependant))
+    {
+        goto graph_load_exit;
+    }
+
+    retcode = 0;
+
+graph_load_exit:
+    free (from); from = NULL;
+    free (to);   to = NULL;
+    if (0 != retcode) graph_free (graph_out);
+
+    return retcode;
+}
+
+
+void
+graph_free (graph_t *graph)
+{
+    if (NULL == graph) return;
+
+    free (graph->package_id);
+    free (graph->dependency_offset);
+    free (graph->dependency);
+    free (graph->dependant_offset);
+    free (graph->dependant);
+    (void)memset (graph, 0, sizeof (graph_t));
+
+    return;
+}
+
+
+uint32_t
+graph_node (const graph_t *graph, int package_id)
+{
+    size_t low = 0, high = 0, mid = 0;
+
+    if ((NULL == graph) || (NULL == graph->package_id)) return GRAPH_NODE_NONE;
+
+    /* nodes are sorted by package_id */
+    high = graph->node_count;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if (graph->package_id[mid] == package_id) return (uint32_t)mid;
+
+        if (graph->package_id[mid] < package_id) low = mid + 1;
+        else high = mid;
+    }
+
+    return GRAPH_NODE_NONE;
+}
+
+
+int
+graph_install_order (const graph_t *graph, const uint32_t *roots, 
+                     size_t root_count, uint32_t *order_out, size_t *n_out,
+                     uint32_t *cycle_out)
+{
+    /* writes the roots and everything they depend on into order_out, 
+     * dependencies first. a NULL roots list orders every node. order_out
+     * must hold node_count entries. returns 0 on success, 1 if a cycle was
+     * found (naming one of its nodes in cycle_out), -1 on error */
+    int retcode = 0;
+    unsigned char *state = NULL;
+    uint32_t *stack = NULL, *edge_iter = NULL;
+    size_t depth = 0, count = 0;
+    uint32_t root, node, next;
+
+    if ((NULL == graph) || (NULL == order_out) || (NULL == n_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (NULL == roots) root_count = graph->node_count;
+
+    state     = calloc (graph->node_count + 1, sizeof (unsigned char));
+    stack     = malloc ((graph->node_count + 1) * sizeof (uint32_t));
+    edge_iter = malloc ((graph->node_count + 1) * sizeof (uint32_t));
+    if ((NULL == state) || (NULL == stack) || (NULL == edge_iter))
+    {
+        errno = ENOMEM;
+        retcode = -1;
+        goto install_order_exit;
+    }
+
+    for (size_t r = 0; (r < root_count) && (0 == retcode); r++)
+    {
+        root = ((NULL == roots) ? (uint32_t)r : roots[r]);
+        if ((graph->node_count <= root) || (NODE_UNVISITED != state[root]))
+        {
+            continue;
+        }
+
+        /* iterative depth first search, a node is emitted once every one
+         * of its dependencies has been */
+        state[root] = NODE_ACTIVE;
+        stack[0] = root;
+        edge_iter[0] = graph->dependency_offset[root];
+        depth = 1;
+
+        while (0 < depth)
+        {
+            node = stack[depth - 1];
+            if (edge_iter[depth - 1] == graph->dependency_offset[node + 1])
+            {
+                state[node] = NODE_DONE;
+                order_out[count++] = node;
+                depth--;
+                continue;
+            }
+
+            next = graph->dependency[edge_iter[depth - 1]++];
+            if (NODE_ACTIVE == state[next])
+            {
+                /* reached a node still on the stack, a cycle */
+                if (NULL != cycle_out) *cycle_out = next;
+                retcode = 1;
+                break;
+            }
+
+            if (NODE_UNVISITED == state[next])
+            {
+                state[next] = NODE_ACTIVE;
+                stack[depth] = next;
+                edge_iter[depth] = graph->dependency_offset[next];
+                depth++;
+            }
+        }
+    }
+
+install_order_exit:
+    free (state);     state = NULL;
+    free (stack);     stack = NULL;
+    free (edge_iter); edge_iter = NULL;
+
+    *n_out = count;
+    return retcode;
+}
+
+
+static void
+push_dependants (const graph_t *graph, uint32_t node, unsigned char *seen,
+                 uint32_t *queue, size_t *count)
+{
+    uint32_t next;
+
+    if (graph->node_count <= node) return;
+
+    for (uint32_t i = graph->dependant_offset[node]; 
+         i < graph->dependant_offset[node + 1]; i++)
+    {
+        next = graph->dependant[i];
+        if (seen[next]) continue;
+
+        seen[next] = 1;
+        queue[(*count)++] = next;
+    }
+
+    return;
+}
+
+
+int
+graph_dependants (const graph_t *graph, const uint32_t *roots, 
+                  size_t root_count, uint32_t *dependants_out, size_t *n_out)
+{
+    /* writes every package depending on the roots, directly or not, into
+     * dependants_out, nearest first. dependants_out must hold node_count
+     * entries, and doubles as the breadth first queue */
+    unsigned char *seen = NULL;
+    size_t head = 0, count = 0;
+    uint32_t node;
+
+    if ((NULL == graph) || (NULL == roots) || (NULL == dependants_out) 
+     || (NULL == n_out))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    seen = calloc (graph->node_count + 1, sizeof (unsigned char));
+    if (NULL == seen)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t r = 0; r < root_count; r++)
+    {
+        if (graph->node_count > roots[r]) seen[roots[r]] = 1;
+    }
+
+    /* breadth first, starting from the roots and then from every 
+     * dependant found so far */
+    for (size_t r = 0; r < root_count; r++)
+    {
+        push_dependants (graph, roots[r], seen, dependants_out, &count);
+    }
+    while (head < count)
+    {
+        node = dependants_out[head++];
+        push_dependants (graph, node, seen, dependants_out, &count);
+    }
+
+    free (seen); seen = NULL;
+
+    *n_out = count;
+    return 0;
+}
+
+
+/* end of file */
@@ -0,0 +1,52 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_GRAPH_HEADER
+#define HEMLOCK_GRAPH_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <sqlite3.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/* the dependencies table loaded as compressed sparse rows. nodes are 
+ * numbered 0..node_count-1 in package_id order; the edges of node n are
+ * edge[offset[n]] up to edge[offset[n + 1]] */
+typedef struct
+{
+    size_t node_count;
+    size_t edge_count;
+    int *package_id;                /* node -> package_id */
+    uint32_t *dependency_offset;    /* node -> its dependencies */
+    uint32_t *dependency;
+    uint32_t *dependant_offset;     /* node -> packages depending on it */
+    uint32_t *dependant;
+} graph_t;
+
+#define GRAPH_NODE_NONE UINT32_MAX
+
+
+int graph_load (sqlite3 *db, graph_t *graph_out, FILE *log);
+void graph_free (graph_t *graph);
+
+uint32_t graph_node (const graph_t *graph, int package_id);
+int graph_install_order (const graph_t *graph, const uint32_t *roots, 
+                         size_t root_count, uint32_t *order_out, 
+                         size_t *n_out, uint32_t *cycle_out);
+int graph_dependants (const graph_t *graph, const uint32_t *roots, 
+                      size_t root_count, uint32_t *dependants_out, 
+                      size_t *n_out);
+
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
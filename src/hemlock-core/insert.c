@@ -10,41 +10,106 @@
 #include "database_core.h"
 #include "mode_template.h"
 #include "settings.h"
+#include "string_utils.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 static int get_sequenced_args (settings_t *settings, int argc, char **argv);
 static int get_field_args (settings_t *settings, int argc, char **argv);
 static void log_insert_help (FILE *fp);
-static void add_to_database (settings_t settings);
-
-
-void _Noreturn
+static sqlite3 *open_database (settings_t settings);
+static db_package_t package_from_settings (settings_t settings);
+static int insert_package (sqlite3 *db, db_package_t *package, 
+                           settings_t settings);
+static int log_file (sqlite3 *db, db_package_t *package, const char *path, 
+                     settings_t settings);
+static int add_file_list (sqlite3 *db, db_package_t *package, 
+                          settings_t settings, size_t *count_out);
+static int add_files_from (sqlite3 *db, db_package_t *package, 
+                           settings_t settings, size_t *count_out);
+static int add_require_list (sqlite3 *db, db_package_t *package, 
+                             settings_t settings);
+static int add_to_database (settings_t settings);
+static int parse_manifest_record (char *line, db_package_t *package);
+static int add_manifest_to_database (settings_t settings);
+
+
+int
 insert_wrapper (int argc, char **argv)
 {
     const required_t required = REQUIRE_NAME | REQUIRE_VERSION;
+    required_t missing = REQUIRE_NONE;
+    int retcode = 0;
+    settings_t settings;
     
-    settings_t settings = mode_template_proccess_args (argc, argv, required, 
-            get_sequenced_args, get_field_args, log_insert_help);
+    /* NAME and VERSION come from the manifest when reading --from */
+    retcode = mode_template_proccess_args (&settings, argc, argv, 
+            REQUIRE_NONE, get_sequenced_args, get_field_args, 
+            log_insert_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if ((NULL != settings.from_file) 
+     && ((NULL != settings.file_list) || (NULL != settings.files_from)
+      || (NULL != settings.require_list)))
+    {
+        fprintf (stderr, "error: --from cannot be combined with a file or "
+                 "package list\n");
+        log_insert_help (stderr);
+        return EXIT_FAILURE;
+    }
 
-    add_to_database (settings);
+    if (NULL != settings.from_file)
+    {
+        retcode = add_manifest_to_database (settings);
+        return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
 
-    exit (EXIT_SUCCESS);
+    missing = settings_validate (settings, required);
+    if (REQUIRE_NONE != missing)
+    {
+        settings_log_required (stderr, missing);
+        log_insert_help (stderr);
+        return EXIT_FAILURE;
+    }
+
+    retcode = add_to_database (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 
-static void
-add_to_database (settings_t settings)
+static sqlite3 *
+open_database (settings_t settings)
+{
+    sqlite3 *db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n", 
+                 settings.database);
+        return NULL;
+    }
+
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        db_close (db); db = NULL;
+        return NULL;
+    }
+
+    return db;
+}
+
+
+static db_package_t
+package_from_settings (settings_t settings)
 {
-    int retcode = 0;
-    sqlite3 *db = NULL;
     db_package_t package;
-    db_package_t *package_list = NULL;
-    size_t list_count = 0;
 
     package.package_id    = 0;
+    package.valid         = PACKAGE_INVALID;
     package.name          = settings.name;
     package.version       = settings.version;
     package.homepage      = settings.homepage;
@@ -53,53 +118,426 @@ add_to_database (settings_t settings)
     package.as_dependency = settings.as_dependency;
     package.is_installed  = settings.is_installed;
 
+    return package;
+}
+
 
-    db = db_open (settings.database);
-    if (NULL == db)
+static int
+insert_package (sqlite3 *db, db_package_t *package, settings_t settings)
+{
+    /* returns 0 on insert, 1 if the package already exists, -1 on error.
+     * with --upsert an existing package is updated instead, and is 0 */
+    int package_id = 0;
+
+    /* a dry run only probes the unique index, nothing is written */
+    if (settings.dry_run)
     {
-        fprintf (stderr, "error: cannot open database at '%s'\n", 
-                 settings.database);
+        switch (db_find_package (db, package->name, package->version, 
+                                 &package_id, NULL))
+        {
+        case 0:  return (settings.upsert ? 0 : 1);
+        case 1:  return 0;
+        default: return -1;
+        }
     }
 
-    retcode = db_create_tables (db, NULL);
-    if (0 != retcode)
+    if (settings.upsert) return db_upsert_package (db, package, NULL);
+
+    return db_insert_package (db, package, NULL);
+}
+
+
+static int
+log_file (sqlite3 *db, db_package_t *package, const char *path, 
+          settings_t settings)
+{
+    if ('\0' == path[0]) return 0;
+    if (settings.dry_run) return 0;
+
+    if (0 != db_insert_filelog (db, package->package_id, path, NULL))
     {
-        fprintf (stderr, "error: cannot create database tables\n");
-        goto add_to_db_exit;
+        fprintf (stderr, "error: cannot log file '%s'\n", path);
+        return -1;
     }
-    
-    package_list = db_search_packages (db, package.name, package.version,
-                                       &list_count, NULL); 
-    if (0 != list_count)
+
+    return 0;
+}
+
+
+static int
+add_file_list (sqlite3 *db, db_package_t *package, settings_t settings,
+               size_t *count_out)
+{
+    int retcode = 0;
+    char **file_arr = NULL;
+    size_t file_count = 0;
+
+    file_arr = string_split (settings.file_list, ",", &file_count);
+    if (NULL == file_arr) return -1;
+
+    for (size_t i = 0; i < file_count; i++)
     {
-        fprintf (stderr, "error: package exists\n");
-        goto add_to_db_exit;
+        /* string_split yields NULL for empty entries */
+        if (NULL == file_arr[i]) continue;
+
+        if (0 == retcode) 
+        {
+            retcode = log_file (db, package, file_arr[i], settings);
+            (*count_out)++;
+        }
+    }
+
+    for (size_t i = 0; i < file_count; i++) free (file_arr[i]);
+    free (file_arr); file_arr = NULL;
+
+    return retcode;
+}
+
+
+static int
+add_files_from (sqlite3 *db, db_package_t *package, settings_t settings,
+                size_t *count_out)
+{
+    int retcode = 0;
+    FILE *fp = NULL;
+    char *path = NULL;
+    size_t path_alloc = 0;
+    const int DELIM = (settings.null_separated ? '\0' : '\n');
+
+    if (0 == strcmp (settings.files_from, "-"))
+    {
+        fp = stdin;
+    }
+    else
+    {
+        fp = fopen (settings.files_from, "r");
+        if (NULL == fp)
+        {
+            fprintf (stderr, "error: cannot open file list '%s'\n", 
+                     settings.files_from);
+            return -1;
+        }
+    }
+
+    /* stream the list, one reused buffer and one cached statement */
+    while ((0 == retcode) 
+        && (NULL != string_read_line (fp, DELIM, &path, &path_alloc)))
+    {
+        retcode = log_file (db, package, path, settings);
+        if ('\0' != path[0]) (*count_out)++;
+    }
+
+    if ((0 == retcode) && (ferror (fp)))
+    {
+        fprintf (stderr, "error: cannot read file list '%s'\n", 
+                 settings.files_from);
+        retcode = -1;
+    }
+
+    free (path); path = NULL;
+    if (stdin != fp) fclose (fp);
+
+    return retcode;
+}
+
+
+static int
+add_require_list (sqlite3 *db, db_package_t *package, settings_t settings)
+{
+    int retcode = 0;
+    int package_id = 0;
+    char **require_arr = NULL;
+    size_t require_count = 0;
+
+    require_arr = string_split (settings.require_list, ",", &require_count);
+    if (NULL == require_arr) return -1;
+
+    for (size_t i = 0; (i < require_count) && (0 == retcode); i++)
+    {
+        /* string_split yields NULL for empty entries */
+        if (NULL == require_arr[i]) continue;
+
+        /* every dependency must already be in the database */
+        retcode = db_resolve_package (db, require_arr[i], &package_id, NULL);
+        if (1 == retcode)
+        {
+            fprintf (stderr, "error: required package '%s' does not exist\n",
+                     require_arr[i]);
+            retcode = -1;
+            break;
+        }
+        if (0 != retcode) break;
+
+        if (!settings.dry_run)
+        {
+            retcode = db_insert_dependency (db, package->package_id, 
+                                            package_id, NULL);
+        }
     }
 
+    for (size_t i = 0; i < require_count; i++) free (require_arr[i]);
+    free (require_arr); require_arr = NULL;
+
+    return retcode;
+}
+
+
+static int
+add_to_database (settings_t settings)
+{
+    int retcode = -1;
+    sqlite3 *db = NULL;
+    db_package_t package = package_from_settings (settings);
+    size_t file_count = 0;
+
+    db = open_database (settings);
+    if (NULL == db) return -1;
+
     if (settings.dry_run)
     {
         fprintf (stderr, "dry run detected\n"); 
     }
-    else
+
+    /* the package and its files are written together, or not at all */
+    if (0 != db_transaction_begin (db, NULL))
+    {
+        fprintf (stderr, "error: cannot begin transaction\n");
+        goto add_to_db_exit;
+    }
+
+    switch (insert_package (db, &package, settings))
+    {
+    case 0:
+        retcode = 0;
+        break;
+    case 1:
+        fprintf (stderr, "error: package exists\n");
+        break;
+    default:
+        fprintf (stderr, "error: cannot insert package\n");
+        break;
+    }
+
+    /* an upsert replaces the lists it is given, rather than adding to them */
+    if ((0 == retcode) && (settings.upsert) && (!settings.dry_run))
     {
-        retcode = db_insert_package (db, &package, NULL);
-        if (0 != retcode)
+        if ((NULL != settings.require_list)
+         && (0 != db_clear_requirements (db, package.package_id, NULL)))
+        {
+            retcode = -1;
+        }
+        if (((NULL != settings.file_list) || (NULL != settings.files_from))
+         && (0 != db_clear_filelogs (db, package.package_id, NULL)))
         {
-            fprintf (stderr, "error: cannot insert package\n");
-            goto add_to_db_exit;
+            retcode = -1;
         }
     }
 
+    if ((0 == retcode) && (NULL != settings.require_list))
+    {
+        retcode = add_require_list (db, &package, settings);
+    }
+
+    if ((0 == retcode) && (NULL != settings.file_list))
+    {
+        retcode = add_file_list (db, &package, settings, &file_count);
+    }
+
+    if ((0 == retcode) && (NULL != settings.files_from))
+    {
+        retcode = add_files_from (db, &package, settings, &file_count);
+    }
+
+    if (0 == retcode)
+    {
+        retcode = db_transaction_commit (db, NULL);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, NULL);
+    }
+
+    if ((0 == retcode) && (settings.verbose))
+    {
+        fprintf (stderr, "%zu file(s) logged\n", file_count);
+    }
+
 add_to_db_exit:
-    for (size_t i = 0; i < list_count; i++)
+    db_close (db); db = NULL;
+
+    return retcode;
+}
+
+
+static int
+parse_manifest_record (char *line, db_package_t *package)
+{
+    /* NAME<TAB>VERSION[<TAB>HOMEPAGE[<TAB>MAINTAINER[<TAB>EMAIL[<TAB>FLAGS]]]]
+     * empty fields keep the value given on the command line, the line is
+     * split in place so the package borrows its strings */
+    enum
+    {
+        FIELD_NAME,
+        FIELD_VERSION,
+        FIELD_HOMEPAGE,
+        FIELD_MAINTAINER,
+        FIELD_EMAIL,
+        FIELD_FLAGS,
+        FIELD_COUNT
+    };
+    char *field[FIELD_COUNT] = { NULL };
+    char *iter = line;
+
+    for (int i = 0; (i < FIELD_COUNT) && (NULL != iter); i++)
+    {
+        field[i] = iter;
+        iter = strchr (iter, '\t');
+        if (NULL != iter) *(iter++) = '\0';
+        if ('\0' == *field[i]) field[i] = NULL;
+    }
+
+    /* trailing fields are a malformed record */
+    if (NULL != iter) return -1;
+
+    if (NULL != field[FIELD_NAME])       package->name       = field[FIELD_NAME];
+    if (NULL != field[FIELD_VERSION])    package->version    = field[FIELD_VERSION];
+    if (NULL != field[FIELD_HOMEPAGE])   package->homepage   = field[FIELD_HOMEPAGE];
+    if (NULL != field[FIELD_MAINTAINER]) package->maintainer = field[FIELD_MAINTAINER];
+    if (NULL != field[FIELD_EMAIL])      package->email      = field[FIELD_EMAIL];
+
+    /* flags use the same letters as their command line options */
+    for (iter = field[FIELD_FLAGS]; (NULL != iter) && ('\0' != *iter); iter++)
+    {
+        switch (*iter)
+        {
+        case 'd': package->as_dependency = true;  break;
+        case 'D': package->as_dependency = false; break;
+        case 'i': package->is_installed  = true;  break;
+        case 'I': package->is_installed  = false; break;
+        default:  return -1;
+        }
+    }
+
+    if ((NULL == package->name) || (NULL == package->version)) return -1;
+
+    return 0;
+}
+
+
+static int
+add_manifest_to_database (settings_t settings)
+{
+    int retcode = 0;
+    sqlite3 *db = NULL;
+    FILE *fp = NULL;
+    char *line = NULL;
+    size_t line_alloc = 0;
+    size_t line_number = 0;
+    size_t inserted = 0, skipped = 0;
+    db_package_t package;
+
+    if (0 == strcmp (settings.from_file, "-"))
+    {
+        fp = stdin;
+    }
+    else
+    {
+        fp = fopen (settings.from_file, "r");
+        if (NULL == fp)
+        {
+            fprintf (stderr, "error: cannot open manifest '%s'\n", 
+                     settings.from_file);
+            return -1;
+        }
+    }
+
+    db = open_database (settings);
+    if (NULL == db)
+    {
+        retcode = -1;
+        goto add_manifest_exit;
+    }
+
+    /* one transaction for the whole manifest, so the catalog is written
+     * with a single journal sync */
+    if (0 != db_transaction_begin (db, NULL))
+    {
+        fprintf (stderr, "error: cannot begin transaction\n");
+        retcode = -1;
+        goto add_manifest_exit;
+    }
+
+    while (NULL != string_read_line (fp, '\n', &line, &line_alloc))
+    {
+        line_number++;
+
+        /* skip blank lines and comments */
+        if (('\0' == line[0]) || ('#' == line[0])) continue;
+
+        package = package_from_settings (settings);
+        if (0 != parse_manifest_record (line, &package))
+        {
+            fprintf (stderr, "error: %s:%zu: malformed package record\n", 
+                     settings.from_file, line_number);
+            retcode = -1;
+            break;
+        }
+
+        switch (insert_package (db, &package, settings))
+        {
+        case 0:
+            inserted++;
+            break;
+        case 1:
+            /* existing packages are skipped so a manifest can be rerun */
+            if (settings.verbose)
+            {
+                fprintf (stderr, "warning: %s:%zu: package exists '%s %s'\n",
+                         settings.from_file, line_number, package.name, 
+                         package.version);
+            }
+            skipped++;
+            break;
+        default:
+            fprintf (stderr, "error: %s:%zu: cannot insert package\n", 
+                     settings.from_file, line_number);
+            retcode = -1;
+            break;
+        }
+        if (0 != retcode) break;
+    }
+
+    if ((0 == retcode) && (ferror (fp)))
+    {
+        fprintf (stderr, "error: cannot read manifest '%s'\n", 
+                 settings.from_file);
+        retcode = -1;
+    }
+
+    /* all or nothing, a failed record discards the whole manifest */
+    if (0 == retcode)
+    {
+        retcode = db_transaction_commit (db, NULL);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, NULL);
+    }
+
+    if ((0 == retcode) && (settings.verbose))
     {
-        db_free_package (package_list + i);
+        fprintf (stderr, "%s%zu package(s) %s, %zu skipped\n", 
+                 (settings.dry_run ? "dry run: " : ""), inserted, 
+                 (settings.upsert ? "inserted or updated" : "inserted"),
+                 skipped);
     }
-    list_count = 0;
-    free (package_list); package_list = NULL;
+
+add_manifest_exit:
+    free (line); line = NULL;
     db_close (db); db = NULL;
+    if ((NULL != fp) && (stdin != fp)) fclose (fp);
 
-    return;
+    return retcode;
 }
 
 
@@ -152,13 +590,21 @@ get_field_args (settings_t *settings, int argc, char **argv)
         INSERT_EMAIL,
         INSERT_REQUIRE,
         INSERT_FILES,
+        INSERT_FILES_FROM,
+        INSERT_NULL,
+        INSERT_FROM,
         INSERT_DEPENDENCY,
         INSERT_STANDALONE,
         INSERT_INSTALLED,
         INSERT_UNINSTALLED,
+        INSERT_UPSERT,
         INSERT_DRY,
         INSERT_DATABASE,
+        INSERT_PROFILE,
         INSERT_DEBUG,
+        INSERT_STATS,
+        INSERT_TRACE,
+        INSERT_SLOW_QUERY,
         INSERT_VERBOSE,
         INSERT_TERSE,
         INSERT_HELP,
@@ -173,15 +619,23 @@ get_field_args (settings_t *settings, int argc, char **argv)
         { INSERT_EMAIL,       "-e", "--email",       CONARG_PARAM_REQUIRED },
         { INSERT_REQUIRE,     "-r", "--require",     CONARG_PARAM_REQUIRED },
         { INSERT_FILES,       "-f", "--files",       CONARG_PARAM_REQUIRED },
+        { INSERT_FILES_FROM,  NULL, "--files-from",  CONARG_PARAM_REQUIRED },
+        { INSERT_NULL,        "-0", "--null",        CONARG_PARAM_NONE },
+        { INSERT_FROM,        NULL, "--from",        CONARG_PARAM_REQUIRED },
         { INSERT_DEPENDENCY,  "-d", "--dependency",  CONARG_PARAM_NONE },
         { INSERT_STANDALONE,  "-D", "--standalone",  CONARG_PARAM_NONE },
         { INSERT_INSTALLED,   "-i", "--installed",   CONARG_PARAM_NONE },
         { INSERT_UNINSTALLED, "-I", "--uninstalled", CONARG_PARAM_NONE },
 
+        { INSERT_UPSERT,   NULL, "--upsert",   CONARG_PARAM_NONE },
         { INSERT_DRY,      NULL, "--dryrun",   CONARG_PARAM_NONE },
         { INSERT_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { INSERT_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
 
         { INSERT_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { INSERT_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { INSERT_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { INSERT_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
         { INSERT_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
         { INSERT_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
         { INSERT_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
@@ -227,6 +681,20 @@ get_field_args (settings_t *settings, int argc, char **argv)
             settings->file_list = conarg_get_param (argc, argv);
             break;
 
+        case INSERT_FILES_FROM:
+            CONARG_STEP (argc, argv);
+            settings->files_from = conarg_get_param (argc, argv);
+            break;
+
+        case INSERT_NULL:
+            settings->null_separated = true;
+            break;
+
+        case INSERT_FROM:
+            CONARG_STEP (argc, argv);
+            settings->from_file = conarg_get_param (argc, argv);
+            break;
+
         case INSERT_REQUIRE:
             CONARG_STEP (argc, argv);
             settings->require_list = conarg_get_param (argc, argv);
@@ -257,6 +725,33 @@ get_field_args (settings_t *settings, int argc, char **argv)
             settings->dry_run = true;
             break;
 
+        case INSERT_UPSERT:
+            settings->upsert = true;
+            break;
+
+        case INSERT_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case INSERT_STATS:
+            settings->stats = true;
+            break;
+
+        case INSERT_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case INSERT_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings, 
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
         case INSERT_DEBUG:
             settings->debug   = true;
             /* fall through, 
@@ -271,14 +766,14 @@ get_field_args (settings_t *settings, int argc, char **argv)
 
         case INSERT_HELP:
             log_insert_help (stdout);
-            exit (EXIT_SUCCESS);
+            return MODE_ARGS_HELP;
 
         /* error states */
         case CONARG_ID_UNKNOWN:
         case CONARG_ID_PARAM_ERROR:
         default:
             log_insert_help (stderr);
-            exit (EXIT_FAILURE);
+            return MODE_ARGS_ERROR;
         }
 
         CONARG_STEP (argc, argv);
@@ -307,20 +802,34 @@ log_insert_help (FILE *fp)
         "  -e, --email EMAIL           define the EMAIL (optional)\n"
         "  -r, --require PACKAGE_LIST  define a PACKAGE_LIST containing the package\n"
         "                                dependencies for the program\n"
-        "  -F, --files FILE_LIST       define a FILE_LIST containing the program's\n"
+        "  -f, --files FILE_LIST       define a FILE_LIST containing the program's\n"
         "                                files\n" 
+        "      --files-from LIST_FILE  read the program's files from LIST_FILE, one\n"
+        "                                path per line, \"-\" reads standard input\n"
+        "  -0, --null                  paths in LIST_FILE are seperated by NUL\n"
+        "                                characters instead of newlines\n"
+        "      --from MANIFEST         insert every package record listed in the\n"
+        "                                MANIFEST file, \"-\" reads standard input\n"
         "  -d, --dependency            mark the package as nothing but a dependency\n"
         "                                for another package\n"
         "  -D, --standalone            mark the package as it's own program\n" 
         "  -i, --installed             mark the package as installed\n"
         "  -I, --uninstalled           mark the package as not yet installed\n"
+        "      --upsert                update the package if it already exists,\n"
+        "                                instead of failing\n"
         "      --database DBFILE       override the package database file, use DBFILE\n"
         "      --dryrun                preform a dry-run. dont preform any writes\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
         "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
         "  -v, --verbose               log extra information\n"
         "  -t, --terse                 only log errors\n"
         "  -h, --help                  show this message\n"
         "\n"
+    };
+    const char *HELP_DETAILS = {
         "The NAME and VERSION arguements are required for a package insert to complete\n"
         "successfully.\n"
         "\n"
@@ -332,6 +841,23 @@ log_insert_help (FILE *fp)
         "package. The provided files are not required to exist in the current\n"
         "file-system; however, it is iladvisable to not install such files.\n"
         "\n"
+        "The LIST_FILE arguement lists the same files as FILE_LIST, but is streamed\n"
+        "rather than passed on the command line, so it suits packages with very many\n"
+        "files. Output of 'find -print0' may be read with --null.\n"
+        "\n"
+        "The MANIFEST arguement is a file of package records, one per line, with\n"
+        "tab seperated fields: NAME, VERSION, HOMEPAGE, MAINTAINER, EMAIL and FLAGS.\n"
+        "Trailing fields may be omitted, and empty fields take the value given on\n"
+        "the command line. FLAGS is any combination of the letters d, D, i and I,\n"
+        "matching their respective options. Lines starting with \"#\" are ignored.\n"
+        "The whole MANIFEST is inserted in one transaction; packages that already\n"
+        "exist are skipped, and any malformed record aborts the insert.\n"
+        "\n"
+        "With --upsert an existing package with the same NAME and VERSION takes the\n"
+        "new HOMEPAGE, MAINTAINER, EMAIL and flags. A given PACKAGE_LIST, FILE_LIST\n"
+        "or LIST_FILE replaces the package's old dependencies or files. Packages in\n"
+        "a MANIFEST are updated rather than skipped.\n"
+        "\n"
         "The DBFILE arguement is expected to be a SQLite3 database, and is expected to\n"
         "exist, if it does not, it will be created.\n"
         "\n"
@@ -344,6 +870,7 @@ log_insert_help (FILE *fp)
     };
 
     fprintf (fp, HELP_MESSAGE);
+    fprintf (fp, HELP_DETAILS);
     fflush (fp);
 }
 
@@ -9,7 +9,7 @@ extern "C" {
 #endif
 /* code start */
 
-void insert_wrapper (int remaining, char **arg_iter);
+int insert_wrapper (int remaining, char **arg_iter);
 
 /* code end */
 #ifdef __cplusplus  /* C++ compatibility */
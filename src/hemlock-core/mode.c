@@ -5,98 +5,177 @@
 #include "mode.h"
 
 #include "arguement.h"
+#include "batch.h"
 #include "config.h"
 #include "insert.h"
+#include "owns.h"
 #include "remove.h"
+#include "search.h"
+#include "stats.h"
+#include "trace.h"
+#include "update.h"
+#ifdef HEMLOCK_DAEMON
+#include "serve.h"
+#endif
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 
+/* the modes, in the order they are matched */
+enum
+{
+    MODE_UPDATE = CONARG_ID_CUSTOM,
+    MODE_INSERT,
+    MODE_SEARCH,
+    MODE_REMOVE,
+    MODE_OWNS,
+    MODE_SERVE,
+    MODE_BATCH,
+    MODE_HELP,
+    MODE_VERSION,
+};
+
+
+static int mode_id (int argc, char **argv);
 static void log_hemlock_help (FILE *fp);
 static void log_hemlock_version (FILE *fp);
 
 
-void _Noreturn
-mode_exec (int argc, char **argv)
+static int
+mode_id (int argc, char **argv)
 {
-    const enum
-    {
-        MODE_UPDATE = CONARG_ID_CUSTOM,
-        MODE_INSERT,
-        MODE_SEARCH,
-        MODE_REMOVE,
-        MODE_HELP,
-        MODE_VERSION,
-    };
-
     const conarg_t ARG_LIST[] =
     {
         { MODE_UPDATE,  NULL, "update",    CONARG_PARAM_NONE },
         { MODE_INSERT,  NULL, "insert",    CONARG_PARAM_NONE },
         { MODE_SEARCH,  NULL, "search",    CONARG_PARAM_NONE },
         { MODE_REMOVE,  NULL, "remove",    CONARG_PARAM_NONE },
+        { MODE_OWNS,    NULL, "owns",      CONARG_PARAM_NONE },
+#ifdef HEMLOCK_DAEMON
+        { MODE_SERVE,   NULL, "serve",     CONARG_PARAM_NONE },
+#endif
+        { MODE_BATCH,   NULL, "batch",     CONARG_PARAM_NONE },
         { MODE_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
         { MODE_VERSION, NULL, "--version", CONARG_PARAM_NONE },
     };
     const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+    conarg_status_t param_stat = CONARG_STATUS_NA;
+
+    return conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+}
+
+
+void _Noreturn
+mode_exec (int argc, char **argv)
+{
+    int status = EXIT_FAILURE;
+
+#ifdef HEMLOCK_DAEMON
+    /* let a running daemon take the command, if there is one */
+    if ((mode_is_forwardable (argc, argv)) 
+     && (0 == serve_forward (argc, argv, &status)))
+    {
+        exit (status);
+    }
+#endif
+
+    stats_begin ();
+    trace_begin ();
+    status = mode_run (argc, argv);
+    trace_end ();
+    stats_end (stderr);
+
+    exit (status);
+}
 
+
+bool
+mode_is_forwardable (int argc, char **argv)
+{
+    /* only the database modes, help, batches and the daemon itself run 
+     * locally */
+    switch (mode_id (argc - 1, argv + 1))
+    {
+    case MODE_UPDATE:
+    case MODE_INSERT:
+    case MODE_SEARCH:
+    case MODE_REMOVE:
+    case MODE_OWNS:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+int
+mode_run (int argc, char **argv)
+{
     /* skip the executable name */
     CONARG_STEP (argc, argv);
 
     /* get the mode */
-    conarg_status_t param_stat = CONARG_STATUS_NA;
-    int id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+    int id = mode_id (argc, argv);
 
     switch (id)    
     {
     case MODE_UPDATE:   /* update mode, pass only args after mode */
-        printf ("update mode unimplemented\n");
-        break;
+        CONARG_STEP (argc, argv);
+        return update_wrapper (argc, argv);
 
     case MODE_INSERT:   /* insert mode, pass only args after mode */
         CONARG_STEP (argc, argv);
-        insert_wrapper (argc, argv);
-        break;
+        return insert_wrapper (argc, argv);
 
     case MODE_SEARCH:   /* search mode, pass only args after mode */
-        printf ("search mode unimplemented\n");
-        break;
+        CONARG_STEP (argc, argv);
+        return search_wrapper (argc, argv);
 
     case MODE_REMOVE:   /* remove mode, pass only args after mode */
         CONARG_STEP (argc, argv);
-        remove_wrapper (argc, argv);
-        printf ("remove mode unimplemented\n");
-        break;
+        return remove_wrapper (argc, argv);
+
+    case MODE_OWNS:     /* owns mode, pass only args after mode */
+        CONARG_STEP (argc, argv);
+        return owns_wrapper (argc, argv);
+
+#ifdef HEMLOCK_DAEMON
+    case MODE_SERVE:    /* daemon mode, pass only args after mode */
+        CONARG_STEP (argc, argv);
+        return serve_wrapper (argc, argv);
+#endif
+
+    case MODE_BATCH:    /* batch mode, pass only args after mode */
+        CONARG_STEP (argc, argv);
+        return batch_wrapper (argc, argv);
 
     case MODE_HELP:     /* hemlock help mode */
         log_hemlock_help (stdout);
-        exit (EXIT_SUCCESS);
-        break;
+        return EXIT_SUCCESS;
 
     case MODE_VERSION:  /* hemlock version mode */
         log_hemlock_version (stdout);
-        exit (EXIT_SUCCESS);
-        break;
+        return EXIT_SUCCESS;
 
     /* error states */
     case CONARG_ID_PARAM_ERROR:
         fprintf (stderr, "error: mode '%s' requires additional parameter\n", 
                  *argv);
         log_hemlock_help (stderr);
-        exit (EXIT_FAILURE);
+        return EXIT_FAILURE;
 
     case CONARG_ID_UNKNOWN:
         fprintf (stderr, "error: unknown mode: '%s'\n", *argv);
         log_hemlock_help (stderr);
-        exit (EXIT_FAILURE);
+        return EXIT_FAILURE;
 
     default:
         log_hemlock_help (stderr);
-        exit (EXIT_FAILURE);
+        return EXIT_FAILURE;
     }
-
-    exit (EXIT_SUCCESS);
 }
 
 
@@ -110,16 +189,21 @@ log_hemlock_help (FILE *fp)
         "\n"
         "Mandatory arguements to long options are mandatory for short options too.\n"
         "modes:\n"
-        "  update NAME [VERSION]       make updates to an existing package entry\n"
+        "  update NAME VERSION         make updates to an existing package entry\n"
         "  insert [NAME [VERSION]]     create a new package entry\n"
-        "  remove NAME [VERSION]       remove a package entry\n"
+        "  remove NAME VERSION         remove a package entry\n"
         "  search QUERY                search for a package entry\n"
+        "  owns PATH...                find the packages that logged each PATH\n"
+#ifdef HEMLOCK_DAEMON
+        "  serve                       serve the other modes from a daemon\n"
+#endif
+        "  batch [FILE]                run many commands in one process\n"
         "special modes:\n"
         "  -h, --help                  show this message\n"
         "      --version               show extra information about the program\n"
         "\n"
-        "The QUERY arguement is a SQL 'like' search query, as such, \"%\" may be used\n"
-        "as a SQL equivelant of pascal regex's \".*?\" non-greedy match.\n"
+        "The QUERY arguement is a list of words, matched as prefixes against package\n"
+        "names, homepages and maintainers. See '" PROJECT_NAME " search --help'.\n"
         "\n"
         "Exit status:\n"
         " 0  if OK,\n"
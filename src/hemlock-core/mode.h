@@ -14,7 +14,11 @@ extern "C" {
  * or     hemlock --help 
  * */
 
+#include <stdbool.h>
+
 void _Noreturn mode_exec (int argc, char **argv);
+int mode_run (int argc, char **argv);
+bool mode_is_forwardable (int argc, char **argv);
 
 /* code end */
 #ifdef __cplusplus  /* C++ compatibility */
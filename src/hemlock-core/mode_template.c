@@ -5,17 +5,24 @@
 #include "mode_template.h"
 
 #include "arguement.h"
+#include "database_core.h"
 #include "settings.h"
+#include "stats.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 
 
-settings_t
-mode_template_proccess_args (int argc, char **argv, required_t required,
+int
+mode_template_proccess_args (settings_t *settings_out, int argc, char **argv,
+                             required_t required,
                              int (*sequence_cb)(settings_t*, int, char**),
                              int (*field_cb)(settings_t*, int, char**),
                              void (*help_cb)(FILE*))
 {    
+    /* returns 0 when the mode should run, 1 when it is already done (help
+     * was requested), and -1 on bad arguements */
+    int retcode = 0;
     required_t missing  = REQUIRE_NONE;
     settings_t settings = settings_default ();
 
@@ -29,7 +36,9 @@ mode_template_proccess_args (int argc, char **argv, required_t required,
     /* get flag arguements */
     if (NULL != field_cb)
     {
-        (void)field_cb (&settings, argc, argv);
+        retcode = field_cb (&settings, argc, argv);
+        if (MODE_ARGS_HELP == retcode) return 1;
+        if (MODE_ARGS_ERROR == retcode) return -1;
     }
 
     /* validate that required settings are present */
@@ -41,11 +50,32 @@ mode_template_proccess_args (int argc, char **argv, required_t required,
         {
             help_cb (stderr);
         }
-        exit (EXIT_FAILURE);
+        return -1;
+    }
+
+    /* --profile, or $HEMLOCK_PROFILE, tunes every connection the mode opens */
+    if (0 != db_select_profile (settings.profile))
+    {
+        fprintf (stderr, "error: unknown profile '%s'\n", 
+                 (NULL != settings.profile ? settings.profile 
+                                           : getenv ("HEMLOCK_PROFILE")));
+        return -1;
     }
-    
-    return settings;
 
+    /* everything after the arguements counts as running the query, until
+     * a database call or the output says otherwise */
+    if (settings.stats) stats_enable ();
+    if (((NULL != settings.trace_file) || (0.0 < settings.slow_query))
+     && (0 != trace_enable (settings.trace_file, settings.slow_query)))
+    {
+        fprintf (stderr, "error: invalid trace file '%s'\n", 
+                 settings.trace_file);
+        return -1;
+    }
+    (void)stats_phase (STATS_PHASE_QUERY);
+    
+    *settings_out = settings;
+    return 0;
 }
 
 
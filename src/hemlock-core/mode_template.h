@@ -12,8 +12,14 @@ extern "C" {
 #include "settings.h"
 #include <stdio.h>
 
-settings_t
-mode_template_proccess_args (int argc, char **argv, required_t required, 
+/* field callbacks return the number of arguements they used, or one of
+ * these to stop the mode early */
+#define MODE_ARGS_ERROR (-1)    /* bad arguements, fail */
+#define MODE_ARGS_HELP  (-2)    /* help was shown, succeed */
+
+int
+mode_template_proccess_args (settings_t *settings_out, int argc, char **argv,
+                             required_t required, 
                              int (*sequence_cb)(settings_t*, int, char**), 
                              int (*field_cb)(settings_t*, int, char **),
                              void (*help_cb)(FILE*));
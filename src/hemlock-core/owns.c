@@ -0,0 +1,401 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "owns.h"
+
+#include "arena.h"
+#include "arguement.h"
+#include "config.h"
+#include "database.h"
+#include "database_core.h"
+#include "mode_template.h"
+#include "settings.h"
+#include "stats.h"
+#include "string_utils.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* paths to look up, from the command line then the LIST_FILE */
+typedef struct
+{
+    char **path;
+    size_t count;
+    size_t alloc;
+} path_list_t;
+
+
+static int get_sequenced_args (settings_t *settings, int argc, char **argv);
+static int get_field_args (settings_t *settings, int argc, char **argv);
+static void log_owns_help (FILE *fp);
+static int add_path (path_list_t *list, arena_t *arena, char *path);
+static int read_paths_from (path_list_t *list, arena_t *arena,
+                            settings_t settings);
+static int find_owners (settings_t settings);
+
+
+int
+owns_wrapper (int argc, char **argv)
+{
+    int retcode = 0;
+    settings_t settings;
+
+    retcode = mode_template_proccess_args (&settings, argc, argv,
+            REQUIRE_NONE, get_sequenced_args, get_field_args,
+            log_owns_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if ((0 == settings.path_count) && (NULL == settings.files_from))
+    {
+        fprintf (stderr, "error: no PATH given\n");
+        log_owns_help (stderr);
+        return EXIT_FAILURE;
+    }
+
+    retcode = find_owners (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static int
+add_path (path_list_t *list, arena_t *arena, char *path)
+{
+    /* the list only holds pointers, the arena owns the strings read */
+    void *temp = NULL;
+
+    if (list->count == list->alloc)
+    {
+        list->alloc = (0 == list->alloc ? 64 : (list->alloc * 2));
+        temp = realloc (list->path, list->alloc * sizeof (char *));
+        if (NULL == temp)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        list->path = temp; temp = NULL;
+    }
+
+    if (NULL != arena) path = arena_string_clone (arena, path);
+    if (NULL == path) return -1;
+
+    list->path[list->count++] = path;
+    return 0;
+}
+
+
+static int
+read_paths_from (path_list_t *list, arena_t *arena, settings_t settings)
+{
+    int retcode = 0;
+    FILE *fp = NULL;
+    char *path = NULL;
+    size_t path_alloc = 0;
+    const int DELIM = (settings.null_separated ? '\0' : '\n');
+
+    if (0 == strcmp (settings.files_from, "-"))
+    {
+        fp = stdin;
+    }
+    else
+    {
+        fp = fopen (settings.files_from, "r");
+        if (NULL == fp)
+        {
+            fprintf (stderr, "error: cannot open file list '%s'\n",
+                     settings.files_from);
+            return -1;
+        }
+    }
+
+    while ((0 == retcode)
+        && (NULL != string_read_line (fp, DELIM, &path, &path_alloc)))
+    {
+        if ('\0' != path[0]) retcode = add_path (list, arena, path);
+    }
+
+    if ((0 == retcode) && (ferror (fp)))
+    {
+        fprintf (stderr, "error: cannot read file list '%s'\n",
+                 settings.files_from);
+        retcode = -1;
+    }
+
+    free (path); path = NULL;
+    if (stdin != fp) fclose (fp);
+
+    return retcode;
+}
+
+
+static int
+find_owners (settings_t settings)
+{
+    int retcode = -1;
+    sqlite3 *db = NULL;
+    arena_t arena;
+    path_list_t list = { NULL, 0, 0 };
+    db_file_owner_t *owners = NULL;
+    size_t owner_count = 0, unowned = 0, next = 0;
+    stats_phase_t phase;
+
+    arena_init (&arena);
+
+    for (size_t i = 0; i < settings.path_count; i++)
+    {
+        if (0 != add_path (&list, NULL, settings.paths[i]))
+        {
+            fprintf (stderr, "error: out of memory\n");
+            goto find_owners_exit;
+        }
+    }
+    if ((NULL != settings.files_from)
+     && (0 != read_paths_from (&list, &arena, settings)))
+    {
+        goto find_owners_exit;
+    }
+
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n",
+                 settings.database);
+        goto find_owners_exit;
+    }
+
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        goto find_owners_exit;
+    }
+
+    if (0 != db_search_file_owner (db, &arena, list.path, list.count,
+                                   &owners, &owner_count, NULL))
+    {
+        fprintf (stderr, "error: cannot search the file logs\n");
+        goto find_owners_exit;
+    }
+
+    /* owners come ordered by path, so the paths between them are unowned */
+    phase = stats_phase (STATS_PHASE_OUTPUT);
+    for (size_t i = 0; i <= owner_count; i++)
+    {
+        size_t end = ((i < owner_count) ? owners[i].path_index : list.count);
+
+        for (; next < end; next++, unowned++)
+        {
+            fprintf (stderr, "no package owns '%s'\n", list.path[next]);
+        }
+        if (i == owner_count) break;
+
+        fprintf (stdout, "%s %s %s\n", owners[i].package->name,
+                 owners[i].package->version, list.path[end]);
+        next = end + 1;
+    }
+    fflush (stdout);
+    (void)stats_phase (phase);
+
+    if (settings.verbose)
+    {
+        fprintf (stderr, "%zu of %zu path(s) owned\n", list.count - unowned,
+                 list.count);
+    }
+
+    retcode = ((0 == unowned) ? 0 : -1);
+
+find_owners_exit:
+    db_close (db); db = NULL;
+    free (list.path); list.path = NULL;
+    arena_free (&arena);
+
+    return retcode;
+}
+
+
+static int
+get_sequenced_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+    char *path = NULL;
+
+    /* owns [PATH...] */
+
+    settings->paths = argv;
+    settings->path_count = 0;
+    while (true)
+    {
+        path = conarg_get_param (argc, argv);
+        if ((NULL == path) || (conarg_is_flag (path))) break;
+
+        settings->path_count++;
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static int
+get_field_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+
+    enum
+    {
+        OWNS_FILES_FROM = CONARG_ID_CUSTOM,
+        OWNS_NULL,
+        OWNS_DATABASE,
+        OWNS_PROFILE,
+        OWNS_DEBUG,
+        OWNS_STATS,
+        OWNS_TRACE,
+        OWNS_SLOW_QUERY,
+        OWNS_VERBOSE,
+        OWNS_TERSE,
+        OWNS_HELP,
+    };
+
+    const conarg_t ARG_LIST[] =
+    {
+        { OWNS_FILES_FROM, NULL, "--files-from", CONARG_PARAM_REQUIRED },
+        { OWNS_NULL,       "-0", "--null",       CONARG_PARAM_NONE },
+        { OWNS_DATABASE,   NULL, "--database",   CONARG_PARAM_REQUIRED },
+        { OWNS_PROFILE,    NULL, "--profile",    CONARG_PARAM_REQUIRED },
+
+        { OWNS_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { OWNS_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { OWNS_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { OWNS_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
+        { OWNS_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { OWNS_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { OWNS_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+
+    int id;
+    conarg_status_t param_stat;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        switch (id)
+        {
+        case OWNS_FILES_FROM:
+            CONARG_STEP (argc, argv);
+            settings->files_from = conarg_get_param (argc, argv);
+            break;
+
+        case OWNS_NULL:
+            settings->null_separated = true;
+            break;
+
+        case OWNS_DATABASE:
+            CONARG_STEP (argc, argv);
+            settings->database = conarg_get_param (argc, argv);
+            break;
+
+        case OWNS_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case OWNS_STATS:
+            settings->stats = true;
+            break;
+
+        case OWNS_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case OWNS_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings,
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case OWNS_DEBUG:
+            settings->debug   = true;
+            /* enable all verbose flags too */
+            /* fall through */
+        case OWNS_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case OWNS_TERSE:
+            settings->verbose = false;
+            break;
+
+        case OWNS_HELP:
+            log_owns_help (stdout);
+            return MODE_ARGS_HELP;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_owns_help (stderr);
+            return MODE_ARGS_ERROR;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static void
+log_owns_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " PROJECT_NAME " owns PATH... [OPTION]...\n"
+        "Find the packages that logged each PATH.\n"
+        "Egless otherwise specified assume -t flag,\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "      --files-from LIST_FILE  also look up the paths in LIST_FILE, one path\n"
+        "                                per line, \"-\" reads standard input\n"
+        "  -0, --null                  paths in LIST_FILE are seperated by NUL\n"
+        "                                characters instead of newlines\n"
+        "      --database DBFILE       override the package database file, use DBFILE\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
+        "  -v, --verbose               log extra information\n"
+        "  -t, --terse                 only log errors\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "Every owner is printed as 'NAME VERSION PATH', in the order the paths were\n"
+        "given. A PATH must match the file log exactly, as it was inserted. Paths\n"
+        "no package owns are reported on stderr. All the paths are looked up in a\n"
+        "single query, so the output of 'find -newer' may be piped to --files-from -.\n"
+        "\n"
+        "The DBFILE arguement is expected to be a SQLite3 database, and is expected to\n"
+        "exist, if it does not, it will be created.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error, or a PATH has no owner.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
@@ -6,8 +6,11 @@
 
 #include "arguement.h"
 #include "config.h"
+#include "database.h"
+#include "database_core.h"
 #include "mode_template.h"
 #include "settings.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -15,29 +18,102 @@
 static int get_sequenced_args (settings_t *settings, int argc, char **argv);
 static int get_field_args (settings_t *settings, int argc, char **argv);
 static void log_remove_help (FILE *fp);
-static void remove_package (settings_t settings);
+static int remove_package (settings_t settings);
 
 
-void _Noreturn
+int
 remove_wrapper (int argc, char **argv)
 {
     const required_t required = REQUIRE_NAME | REQUIRE_VERSION;
+    int retcode = 0;
+    settings_t settings;
     
-    settings_t settings = mode_template_proccess_args (argc, argv, required, 
+    retcode = mode_template_proccess_args (&settings, argc, argv, required, 
             get_sequenced_args, get_field_args, log_remove_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
 
-    remove_package (settings);
+    retcode = remove_package (settings);
 
-    exit (EXIT_SUCCESS);
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 
-static void
+static int
 remove_package (settings_t settings)
 {
-    printf ("removeing package\n");
-    settings_print (stdout, settings);
-    return;
+    int retcode = -1;
+    int package_id = 0;
+    size_t removed = 0;
+    sqlite3 *db = NULL;
+
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n", 
+                 settings.database);
+        return -1;
+    }
+
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        goto remove_package_exit;
+    }
+
+    if (settings.dry_run)
+    {
+        fprintf (stderr, "dry run detected\n"); 
+    }
+
+    /* a dry run does all the work, then rolls it back */
+    if (0 != db_transaction_begin (db, NULL))
+    {
+        fprintf (stderr, "error: cannot begin transaction\n");
+        goto remove_package_exit;
+    }
+
+    retcode = db_find_package (db, settings.name, settings.version, 
+                               &package_id, NULL);
+    if (1 == retcode)
+    {
+        fprintf (stderr, "error: package does not exist\n");
+        retcode = -1;
+    }
+
+    if (0 == retcode)
+    {
+        retcode = db_remove_package (db, package_id, settings.cascade, 
+                                     settings.force, &removed, NULL);
+        if (1 == retcode)
+        {
+            fprintf (stderr, "error: package is required by other packages, "
+                     "use --force to remove it anyway\n");
+            retcode = -1;
+        }
+        else if (0 != retcode)
+        {
+            fprintf (stderr, "error: cannot remove package\n");
+        }
+    }
+
+    if ((0 == retcode) && (!settings.dry_run))
+    {
+        retcode = db_transaction_commit (db, NULL);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, NULL);
+    }
+
+    if ((0 == retcode) && (settings.verbose))
+    {
+        fprintf (stderr, "%zu package(s) removed\n", removed);
+    }
+
+remove_package_exit:
+    db_close (db); db = NULL;
+
+    return retcode;
 }
 
 
@@ -48,7 +124,7 @@ get_sequenced_args (settings_t *settings, int argc, char **argv)
     char *name    = NULL;
     char *version = NULL;
 
-    /* insert [NAME [VERSION]] */
+    /* remove [NAME [VERSION]] */
 
     /* name (optional) */
     name = conarg_get_param (argc, argv);
@@ -83,23 +159,35 @@ get_field_args (settings_t *settings, int argc, char **argv)
 
     const enum 
     {
-        INSERT_DRY = CONARG_ID_CUSTOM,
-        INSERT_DATABASE,
-        INSERT_DEBUG,
-        INSERT_VERBOSE,
-        INSERT_TERSE,
-        INSERT_HELP,
+        REMOVE_DRY = CONARG_ID_CUSTOM,
+        REMOVE_DATABASE,
+        REMOVE_CASCADE,
+        REMOVE_FORCE,
+        REMOVE_PROFILE,
+        REMOVE_DEBUG,
+        REMOVE_STATS,
+        REMOVE_TRACE,
+        REMOVE_SLOW_QUERY,
+        REMOVE_VERBOSE,
+        REMOVE_TERSE,
+        REMOVE_HELP,
     };
 
     const conarg_t ARG_LIST[] = 
     {
-        { INSERT_DRY,      NULL, "--dryrun",   CONARG_PARAM_NONE },
-        { INSERT_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
-
-        { INSERT_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
-        { INSERT_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
-        { INSERT_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
-        { INSERT_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+        { REMOVE_DRY,      NULL, "--dryrun",   CONARG_PARAM_NONE },
+        { REMOVE_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { REMOVE_CASCADE,  "-c", "--cascade",  CONARG_PARAM_NONE },
+        { REMOVE_FORCE,    "-f", "--force",    CONARG_PARAM_NONE },
+        { REMOVE_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
+
+        { REMOVE_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { REMOVE_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { REMOVE_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { REMOVE_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
+        { REMOVE_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { REMOVE_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { REMOVE_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
     };
     const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
     
@@ -113,37 +201,68 @@ get_field_args (settings_t *settings, int argc, char **argv)
 
         switch (id)
         {
-        case INSERT_DATABASE:
+        case REMOVE_DATABASE:
             CONARG_STEP (argc, argv);
             settings->database = conarg_get_param (argc, argv);
             break;
 
-        case INSERT_DRY:
+        case REMOVE_DRY:
             settings->dry_run = true;
             break;
 
-        case INSERT_DEBUG:
+        case REMOVE_CASCADE:
+            settings->cascade = true;
+            break;
+
+        case REMOVE_FORCE:
+            settings->force = true;
+            break;
+
+        case REMOVE_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case REMOVE_STATS:
+            settings->stats = true;
+            break;
+
+        case REMOVE_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case REMOVE_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings, 
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case REMOVE_DEBUG:
             settings->debug   = true;
             /* fall through, 
              * enable all verbose flags too */
-        case INSERT_VERBOSE:
+        case REMOVE_VERBOSE:
             settings->verbose = true;
             break;
 
-        case INSERT_TERSE:
+        case REMOVE_TERSE:
             settings->verbose = false;
             break;
 
-        case INSERT_HELP:
+        case REMOVE_HELP:
             log_remove_help (stdout);
-            exit (EXIT_SUCCESS);
+            return MODE_ARGS_HELP;
 
         /* error states */
         case CONARG_ID_UNKNOWN:
         case CONARG_ID_PARAM_ERROR:
         default:
             log_remove_help (stderr);
-            exit (EXIT_FAILURE);
+            return MODE_ARGS_ERROR;
         }
 
         CONARG_STEP (argc, argv);
@@ -164,13 +283,21 @@ log_remove_help (FILE *fp)
         "Mandatory arguements to long options are mandatory for short options too.\n"
         "      --database DBFILE       override the package database file, use DBFILE\n"
         "      --dryrun                preform a dry-run. dont preform any writes\n"
+        "  -c, --cascade               also remove dependency packages nothing else\n"
+        "                              requires anymore\n"
+        "  -f, --force                 remove the package even if others require it\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
         "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
         "  -v, --verbose               log extra information\n"
         "  -t, --terse                 only log errors\n"
         "  -h, --help                  show this message\n"
         "\n"
-        "The NAME and VERSION arguements are required for a package insert to complete\n"
-        "successfully.\n"
+        "The NAME and VERSION arguements are required, and must match the package\n"
+        "exactly. The package, its file logs and its dependency links are removed\n"
+        "together in one transaction.\n"
         "\n"
         "The DBFILE arguement is expected to be a SQLite3 database, and is expected to\n"
         "exist, if it does not, it will be created.\n"
@@ -0,0 +1,524 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "search.h"
+
+#include "arguement.h"
+#include "config.h"
+#include "database.h"
+#include "database_core.h"
+#include "graph.h"
+#include "mode_template.h"
+#include "settings.h"
+#include "stats.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static int get_sequenced_args (settings_t *settings, int argc, char **argv);
+static int get_field_args (settings_t *settings, int argc, char **argv);
+static void log_search_help (FILE *fp);
+static void log_package (FILE *fp, string_builder_t *line, 
+                         db_package_t *package, bool verbose);
+static int open_search (db_package_cursor_t *cursor, sqlite3 *db, 
+                        settings_t settings);
+static int search_graph (sqlite3 *db, settings_t settings);
+static bool is_blank (const char *text);
+static int search_database (settings_t settings);
+
+
+int
+search_wrapper (int argc, char **argv)
+{
+    const required_t required = REQUIRE_NAME;
+    required_t missing = REQUIRE_NONE;
+    int retcode = 0;
+    settings_t settings;
+    
+    /* QUERY may be left out to list the latest or upgradable of everything */
+    retcode = mode_template_proccess_args (&settings, argc, argv, 
+            REQUIRE_NONE, get_sequenced_args, get_field_args, 
+            log_search_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    /* a QUERY without a single word has nothing to match, it counts as
+     * left out. a --like pattern is taken as given */
+    if ((!settings.like_search) && (is_blank (settings.name)))
+    {
+        settings.name = NULL;
+    }
+
+    if (settings.list_latest || settings.list_upgradable)
+    {
+        if (NULL == settings.name)
+        {
+            settings.name = "%";
+            settings.like_search = true;
+        }
+    }
+
+    missing = settings_validate (settings, required);
+    if (REQUIRE_NONE != missing)
+    {
+        settings_log_required (stderr, missing);
+        log_search_help (stderr);
+        return EXIT_FAILURE;
+    }
+
+    retcode = search_database (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static bool
+is_blank (const char *text)
+{
+    if (NULL == text) return false;
+
+    for (; '\0' != *text; text++)
+    {
+        if (!isspace ((unsigned char)*text)) return false;
+    }
+    return true;
+}
+
+
+static int
+open_search (db_package_cursor_t *cursor, sqlite3 *db, settings_t settings)
+{
+    db_package_filter_t filter = PACKAGE_FILTER_NONE;
+
+    if (settings.list_latest)     filter = PACKAGE_FILTER_LATEST;
+    if (settings.list_upgradable) filter = PACKAGE_FILTER_UPGRADABLE;
+
+    /* the full text index ranks matches, --like scans with a pattern */
+    if (settings.like_search)
+    {
+        return db_package_cursor_open (cursor, db, settings.name, 
+                                       settings.version, filter, NULL);
+    }
+
+    return db_package_cursor_open_match (cursor, db, settings.name, filter,
+                                         NULL);
+}
+
+
+static int
+search_graph (sqlite3 *db, settings_t settings)
+{
+    int retcode = -1;
+    graph_t graph;
+    arena_t arena;
+    db_package_cursor_t cursor;
+    db_package_t package;
+    db_package_t *match = NULL;
+    uint32_t *roots = NULL, *result = NULL;
+    uint32_t node = GRAPH_NODE_NONE, cycle = GRAPH_NODE_NONE;
+    size_t root_count = 0, result_count = 0;
+    stats_phase_t phase;
+    string_builder_t line;
+
+    arena_init (&arena);
+    string_builder_init (&line);
+
+    if (0 != graph_load (db, &graph, NULL))
+    {
+        fprintf (stderr, "error: cannot load the dependency graph\n");
+        return -1;
+    }
+
+    roots  = malloc ((graph.node_count + 1) * sizeof (uint32_t));
+    result = malloc ((graph.node_count + 1) * sizeof (uint32_t));
+    if ((NULL == roots) || (NULL == result))
+    {
+        fprintf (stderr, "error: out of memory\n");
+        goto search_graph_exit;
+    }
+
+    /* every match of the query is a root of the walk */
+    if (0 != open_search (&cursor, db, settings))
+    {
+        fprintf (stderr, "error: cannot search the database\n");
+        goto search_graph_exit;
+    }
+    while ((root_count < graph.node_count)
+        && (1 == db_package_cursor_next (&cursor, &package)))
+    {
+        node = graph_node (&graph, package.package_id);
+        if (GRAPH_NODE_NONE != node) roots[root_count++] = node;
+    }
+    db_package_cursor_close (&cursor);
+
+    if (settings.list_requires)
+    {
+        retcode = graph_install_order (&graph, roots, root_count, result, 
+                                       &result_count, &cycle);
+    }
+    else
+    {
+        retcode = graph_dependants (&graph, roots, root_count, result, 
+                                    &result_count);
+    }
+
+    if (1 == retcode)
+    {
+        match = db_search_package_id (db, &arena, graph.package_id[cycle], 
+                                      NULL);
+        fprintf (stderr, "error: dependency cycle through '%s %s'\n", 
+                 (NULL != match ? match->name : "?"), 
+                 (NULL != match ? match->version : "?"));
+        retcode = -1;
+    }
+    if (0 != retcode) goto search_graph_exit;
+
+    /* install order lists dependencies before the packages needing them */
+    for (size_t i = 0; i < result_count; i++)
+    {
+        match = db_search_package_id (db, &arena, 
+                                      graph.package_id[result[i]], NULL);
+        phase = stats_phase (STATS_PHASE_OUTPUT);
+        if (NULL != match) log_package (stdout, &line, match, settings.verbose);
+        (void)stats_phase (phase);
+    }
+
+    phase = stats_phase (STATS_PHASE_OUTPUT);
+    fflush (stdout);
+    (void)stats_phase (phase);
+
+search_graph_exit:
+    string_builder_free (&line);
+    free (roots);  roots = NULL;
+    free (result); result = NULL;
+    arena_free (&arena);
+    graph_free (&graph);
+
+    return retcode;
+}
+
+
+static int
+search_database (settings_t settings)
+{
+    int retcode = 0;
+    sqlite3 *db = NULL;
+    db_package_cursor_t cursor;
+    db_package_t package;
+    size_t match_count = 0;
+    stats_phase_t phase;
+    string_builder_t line;
+
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n", 
+                 settings.database);
+        return -1;
+    }
+
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        db_close (db); db = NULL;
+        return -1;
+    }
+
+    if (settings.list_requires || settings.list_dependants)
+    {
+        retcode = search_graph (db, settings);
+        db_close (db); db = NULL;
+        return retcode;
+    }
+
+    if (0 != open_search (&cursor, db, settings))
+    {
+        fprintf (stderr, "error: cannot search the database\n");
+        db_close (db); db = NULL;
+        return -1;
+    }
+
+    /* stream each match out as soon as it is found, through one line
+     * buffer reused for every package */
+    string_builder_init (&line);
+    while (1 == (retcode = db_package_cursor_next (&cursor, &package)))
+    {
+        phase = stats_phase (STATS_PHASE_OUTPUT);
+        log_package (stdout, &line, &package, settings.verbose);
+        (void)stats_phase (phase);
+        match_count++;
+    }
+    db_package_cursor_close (&cursor);
+    string_builder_free (&line);
+
+    phase = stats_phase (STATS_PHASE_OUTPUT);
+    fflush (stdout);
+    (void)stats_phase (phase);
+
+    if (0 > retcode)
+    {
+        fprintf (stderr, "error: search failed\n");
+    }
+    else if (settings.verbose)
+    {
+        fprintf (stderr, "%zu package(s) found\n", match_count);
+    }
+
+    db_close (db); db = NULL;
+
+    return ((0 > retcode) ? -1 : 0);
+}
+
+
+static void
+log_package (FILE *fp, string_builder_t *line, db_package_t *package, 
+             bool verbose)
+{
+    if (!verbose)
+    {
+        fprintf (fp, "%s %s\n", package->name, package->version);
+        return;
+    }
+
+    string_builder_reset (line);
+    if ((0 == db_append_readable_package (line, package))
+     && (0 == string_builder_append_char (line, '\n')))
+    {
+        (void)fwrite (line->data, 1, line->length, fp);
+    }
+
+    return;
+}
+
+
+static int
+get_sequenced_args (settings_t *settings, int argc, char **argv)
+{   
+    int initial_count = argc;
+    char *query = NULL;
+
+    /* search QUERY */
+
+    query = conarg_get_param (argc, argv);
+    if ((NULL == query) || (conarg_is_flag (query))) 
+    {
+        query = NULL;
+        goto sequence_exit;
+    }
+    CONARG_STEP (argc, argv);
+
+sequence_exit:
+    settings->name = query;
+
+    return (initial_count - argc);
+}
+
+
+static int
+get_field_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+
+    enum 
+    {
+        SEARCH_LIKE = CONARG_ID_CUSTOM,
+        SEARCH_VERSION,
+        SEARCH_REQUIRES,
+        SEARCH_DEPENDANTS,
+        SEARCH_LATEST,
+        SEARCH_UPGRADABLE,
+        SEARCH_DATABASE,
+        SEARCH_PROFILE,
+        SEARCH_DEBUG,
+        SEARCH_STATS,
+        SEARCH_TRACE,
+        SEARCH_SLOW_QUERY,
+        SEARCH_VERBOSE,
+        SEARCH_TERSE,
+        SEARCH_HELP,
+    };
+
+    const conarg_t ARG_LIST[] = 
+    {
+        { SEARCH_LIKE,     "-l", "--like",     CONARG_PARAM_NONE },
+        { SEARCH_VERSION,  "-V", "--version",  CONARG_PARAM_REQUIRED },
+        { SEARCH_REQUIRES,   "-r", "--requires",   CONARG_PARAM_NONE },
+        { SEARCH_DEPENDANTS, "-R", "--dependants", CONARG_PARAM_NONE },
+        { SEARCH_LATEST,     "-L", "--latest",     CONARG_PARAM_NONE },
+        { SEARCH_UPGRADABLE, "-U", "--upgradable", CONARG_PARAM_NONE },
+        { SEARCH_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { SEARCH_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
+
+        { SEARCH_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { SEARCH_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { SEARCH_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { SEARCH_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
+        { SEARCH_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { SEARCH_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { SEARCH_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+    
+    int id;
+    conarg_status_t param_stat;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        switch (id)
+        {
+        case SEARCH_LIKE:
+            settings->like_search = true;
+            break;
+
+        case SEARCH_VERSION:
+            CONARG_STEP (argc, argv);
+            settings->version = conarg_get_param (argc, argv);
+            break;
+
+        case SEARCH_REQUIRES:
+            settings->list_requires   = true;
+            settings->list_dependants = false;
+            break;
+
+        case SEARCH_DEPENDANTS:
+            settings->list_dependants = true;
+            settings->list_requires   = false;
+            break;
+
+        case SEARCH_LATEST:
+            settings->list_latest     = true;
+            settings->list_upgradable = false;
+            break;
+
+        case SEARCH_UPGRADABLE:
+            settings->list_upgradable = true;
+            settings->list_latest     = false;
+            break;
+
+        case SEARCH_DATABASE:
+            CONARG_STEP (argc, argv);
+            settings->database = conarg_get_param (argc, argv);
+            break;
+
+        case SEARCH_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case SEARCH_STATS:
+            settings->stats = true;
+            break;
+
+        case SEARCH_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case SEARCH_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings, 
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case SEARCH_DEBUG:
+            settings->debug   = true;
+            /* enable all verbose flags too */
+            /* fall through */
+        case SEARCH_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case SEARCH_TERSE:
+            settings->verbose = false;
+            break;
+
+        case SEARCH_HELP:
+            log_search_help (stdout);
+            return MODE_ARGS_HELP;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_search_help (stderr);
+            return MODE_ARGS_ERROR;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static void
+log_search_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " PROJECT_NAME " search [QUERY] [OPTION]...\n"
+        "Search the package database.\n"
+        "Egless otherwise specified assume -t flag,\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "  -l, --like                  match QUERY as a SQL 'like' pattern against\n"
+        "                                package names, instead of the full text\n"
+        "                                index\n"
+        "  -V, --version VERSION       only match versions like VERSION, requires\n"
+        "                                --like\n"
+        "  -r, --requires              list the matches and everything they depend on,\n"
+        "                                in install order\n"
+        "  -R, --dependants            list every package depending on the matches\n"
+        "  -L, --latest                only match the newest version of each package\n"
+        "  -U, --upgradable            only match installed versions with a newer\n"
+        "                                version in the database\n"
+        "      --database DBFILE       override the package database file, use DBFILE\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
+        "  -v, --verbose               log every package field\n"
+        "  -t, --terse                 log only package names and versions\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "By default, every word of QUERY is matched as a prefix against the package\n"
+        "names, homepages and maintainers, and results are ranked best match first,\n"
+        "with name matches weighted highest.\n"
+        "\n"
+        "With --requires, dependencies are always listed before the packages that\n"
+        "need them, and a dependency cycle is reported as an error.\n"
+        "\n"
+        "QUERY may only be left out, or blank, with --latest or --upgradable, which\n"
+        "then match every package. Versions are compared part by part, numbers by\n"
+        "value, so 1.9 < 1.10, and a pre-release (~, dev, alpha, beta, pre or rc)\n"
+        "comes before its release: 1.0rc1 < 1.0 < 1.0a < 1.0.1\n"
+        "\n"
+        "With --like, QUERY is a SQL 'like' search query, as such, \"%\" may be used\n"
+        "as a SQL equivelant of pascal regex's \".*?\" non-greedy match. Matches are\n"
+        "listed by name, oldest version first.\n"
+        "\n"
+        "The DBFILE arguement is expected to be a SQLite3 database, and is expected to\n"
+        "exist, if it does not, it will be created.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, "%s", HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
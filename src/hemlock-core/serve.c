@@ -0,0 +1,795 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#define _POSIX_C_SOURCE 200809L
+#if defined(__linux__)
+#define _GNU_SOURCE         /* struct ucred, for SO_PEERCRED */
+#endif
+
+#include "serve.h"
+
+#include "arguement.h"
+#include "config.h"
+#include "database_core.h"
+#include "mode.h"
+#include "mode_template.h"
+#include "settings.h"
+#include "stats.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if defined(HAVE___FPURGE)
+#include <stdio_ext.h>
+#endif
+
+
+/* every request starts with this header, followed by the client's working
+ * directory and its arguements, each NUL terminated. the client's stdin,
+ * stdout and stderr ride along with the header. the reply is the exit
+ * status as an int32_t */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t length;
+} serve_request_t;
+
+#define SERVE_MAGIC       0x484D4C4B    /* "HMLK" */
+#define SERVE_FD_COUNT    3
+#define SERVE_REQUEST_MAX (1 << 20)
+#define SERVE_BACKLOG     16
+#define SERVE_TIMEOUT     5             /* seconds to send a request */
+
+static volatile sig_atomic_t s_stop = 0;
+
+
+static int get_field_args (settings_t *settings, int argc, char **argv);
+static void log_serve_help (FILE *fp);
+static const char *socket_path (settings_t *settings);
+static int make_address (const char *path, struct sockaddr_un *addr);
+static int peer_uid (int fd, uid_t *uid_out);
+static int write_all (int fd, const void *data, size_t n);
+static int read_all (int fd, void *data, size_t n);
+static int receive_request (int client, serve_request_t *request,
+                            int fds[SERVE_FD_COUNT]);
+static void discard_input (FILE *fp);
+static int run_request (int argc, char **argv, const char *cwd,
+                        int fds[SERVE_FD_COUNT], int saved[SERVE_FD_COUNT],
+                        int home_fd);
+static void handle_client (int client, int saved[SERVE_FD_COUNT],
+                           int home_fd, bool verbose);
+static int open_listener (const char *path);
+static void handle_stop (int signum);
+static int serve (settings_t settings);
+
+
+int
+serve_wrapper (int argc, char **argv)
+{
+    int retcode = 0;
+    settings_t settings;
+
+    retcode = mode_template_proccess_args (&settings, argc, argv,
+            REQUIRE_NONE, NULL, get_field_args, log_serve_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    retcode = serve (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static const char *
+socket_path (settings_t *settings)
+{
+    /* --socket, then $HEMLOCK_SOCKET, then the default in the user's own
+     * runtime directory. NULL when there is no runtime directory */
+    static char s_default[sizeof (((struct sockaddr_un *)0)->sun_path)];
+    const char *path = NULL;
+    int length = 0;
+
+    if ((NULL != settings) && (NULL != settings->socket))
+    {
+        return settings->socket;
+    }
+
+    path = getenv ("HEMLOCK_SOCKET");
+    if (NULL != path) return path;
+
+    path = getenv ("XDG_RUNTIME_DIR");
+    if ((NULL == path) || ('/' != path[0])) return NULL;
+
+    length = snprintf (s_default, sizeof (s_default), "%s/%s", path, 
+                       HEMLOCK_SOCKET_FILE);
+    if ((0 > length) || (sizeof (s_default) <= (size_t)length)) return NULL;
+
+    return s_default;
+}
+
+
+static int
+make_address (const char *path, struct sockaddr_un *addr)
+{
+    size_t length = strlen (path);
+
+    if ((0 == length) || (sizeof (addr->sun_path) <= length))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset (addr, 0, sizeof (*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy (addr->sun_path, path, length + 1);
+
+    return 0;
+}
+
+
+static int
+peer_uid (int fd, uid_t *uid_out)
+{
+    /* the user running the process on the other end of a unix socket */
+#if defined(HAVE_SO_PEERCRED)
+    struct ucred cred;
+    socklen_t length = sizeof (cred);
+
+    if (0 != getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &length))
+    {
+        return -1;
+    }
+
+    *uid_out = cred.uid;
+    return 0;
+#elif defined(HAVE_GETPEEREID)
+    gid_t gid;
+
+    return getpeereid (fd, uid_out, &gid);
+#else
+    (void)fd;
+    (void)uid_out;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+static int
+write_all (int fd, const void *data, size_t n)
+{
+    const char *iter = data;
+    ssize_t written;
+
+    while (0 < n)
+    {
+        written = write (fd, iter, n);
+        if ((0 > written) && (EINTR == errno)) continue;
+        if (0 >= written) return -1;
+
+        iter += written;
+        n    -= (size_t)written;
+    }
+
+    return 0;
+}
+
+
+static int
+read_all (int fd, void *data, size_t n)
+{
+    char *iter = data;
+    ssize_t count;
+
+    while (0 < n)
+    {
+        count = read (fd, iter, n);
+        if ((0 > count) && (EINTR == errno)) continue;
+        if (0 >= count) return -1;
+
+        iter += count;
+        n    -= (size_t)count;
+    }
+
+    return 0;
+}
+
+
+int
+serve_forward (int argc, char **argv, int *status_out)
+{
+    /* hands the command to a running daemon. returns 0 once the daemon
+     * has run it, with its exit status in status_out, or -1 when there is
+     * no daemon to ask and the command should run locally */
+    const char *path = socket_path (NULL);
+    struct sockaddr_un addr;
+    struct stat info;
+    serve_request_t request;
+    int fds[SERVE_FD_COUNT] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    union
+    {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE (sizeof (fds))];
+    } control;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    char *cwd = NULL, *payload = NULL, *iter = NULL;
+    size_t cwd_alloc = 256, length = 0;
+    int32_t status = EXIT_FAILURE;
+    uid_t uid;
+    int client = -1;
+    int retcode = -1;
+
+    /* an empty $HEMLOCK_SOCKET turns forwarding off */
+    if ((NULL == status_out) || (NULL == path) 
+     || (0 != make_address (path, &addr))) return -1;
+    if ((0 != stat (path, &info)) || (!S_ISSOCK (info.st_mode))) return -1;
+
+    /* our streams, directory and arguements only go to our own daemon */
+    if (getuid () != info.st_uid)
+    {
+        fprintf (stderr, "warning: ignoring socket '%s', another user owns "
+                 "it\n", path);
+        return -1;
+    }
+
+    client = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (0 > client) return -1;
+    if (0 != connect (client, (struct sockaddr *)&addr, sizeof (addr)))
+    {
+        /* a stale socket, nobody is serving it */
+        close (client);
+        return -1;
+    }
+    if ((0 != peer_uid (client, &uid)) || (getuid () != uid))
+    {
+        fprintf (stderr, "warning: ignoring socket '%s', another user "
+                 "serves it\n", path);
+        close (client);
+        return -1;
+    }
+
+    /* relative paths in the arguements are the client's, not the daemon's */
+    while (NULL == cwd)
+    {
+        cwd = malloc (cwd_alloc);
+        if (NULL == cwd) goto forward_exit;
+        if (NULL != getcwd (cwd, cwd_alloc)) break;
+
+        free (cwd); cwd = NULL;
+        if (ERANGE != errno) goto forward_exit;
+        cwd_alloc *= 2;
+    }
+
+    length = strlen (cwd) + 1;
+    for (int i = 0; i < argc; i++) length += strlen (argv[i]) + 1;
+    if (SERVE_REQUEST_MAX < length) goto forward_exit;
+
+    payload = malloc (length);
+    if (NULL == payload) goto forward_exit;
+
+    iter = payload;
+    for (int i = -1; i < argc; i++)
+    {
+        const char *arg = ((0 > i) ? cwd : argv[i]);
+        size_t n = strlen (arg) + 1;
+
+        memcpy (iter, arg, n);
+        iter += n;
+    }
+
+    request.magic  = SERVE_MAGIC;
+    request.argc   = (uint32_t)argc;
+    request.length = (uint32_t)length;
+
+    /* the header carries our stdin, stdout and stderr */
+    memset (&msg, 0, sizeof (msg));
+    memset (&control, 0, sizeof (control));
+    iov.iov_base       = &request;
+    iov.iov_len        = sizeof (request);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof (control.buffer);
+
+    cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN (sizeof (fds));
+    memcpy (CMSG_DATA (cmsg), fds, sizeof (fds));
+
+    if ((ssize_t)sizeof (request) != sendmsg (client, &msg, 0)) goto forward_exit;
+
+    /* from here on the daemon may have run the command, so a failure can
+     * no longer fall back to running it locally */
+    retcode = 0;
+    if ((0 != write_all (client, payload, length))
+     || (0 != read_all (client, &status, sizeof (status))))
+    {
+        fprintf (stderr, "error: lost connection to the daemon at '%s'\n",
+                 path);
+        status = EXIT_FAILURE;
+    }
+    *status_out = status;
+
+forward_exit:
+    free (payload); payload = NULL;
+    free (cwd);     cwd = NULL;
+    close (client);
+
+    return retcode;
+}
+
+
+static int
+receive_request (int client, serve_request_t *request,
+                 int fds[SERVE_FD_COUNT])
+{
+    union
+    {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE (SERVE_FD_COUNT * sizeof (int))];
+    } control;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    ssize_t count;
+    int received = 0;
+
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base       = request;
+    iov.iov_len        = sizeof (*request);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof (control.buffer);
+
+    do
+    {
+        count = recvmsg (client, &msg, 0);
+    } while ((0 > count) && (EINTR == errno));
+    if (0 >= count) return -1;
+
+    /* take ownership of whatever descriptors arrived */
+    for (cmsg = CMSG_FIRSTHDR (&msg); NULL != cmsg;
+         cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+        if ((SOL_SOCKET != cmsg->cmsg_level) || (SCM_RIGHTS != cmsg->cmsg_type))
+        {
+            continue;
+        }
+
+        received = (int)((cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int));
+        if (SERVE_FD_COUNT < received) received = SERVE_FD_COUNT;
+        memcpy (fds, CMSG_DATA (cmsg), received * sizeof (int));
+        break;
+    }
+
+    /* a short header read leaves the rest in the stream */
+    if ((sizeof (*request) > (size_t)count)
+     && (0 != read_all (client, (char *)request + count,
+                        sizeof (*request) - count)))
+    {
+        received = -received;
+    }
+
+    if ((SERVE_FD_COUNT != received) || (MSG_CTRUNC & msg.msg_flags)
+     || (SERVE_MAGIC != request->magic) || (0 == request->argc)
+     || (SERVE_REQUEST_MAX < request->length))
+    {
+        for (int i = 0; i < abs (received); i++) close (fds[i]);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+discard_input (FILE *fp)
+{
+    /* input the last request buffered but did not read belongs to that
+     * client, drop it before the next one. without a purge the stream is
+     * left unbuffered, see serve () */
+#if defined(HAVE___FPURGE)
+    __fpurge (fp);
+#elif defined(HAVE_FPURGE)
+    (void)fpurge (fp);
+#endif
+    clearerr (fp);
+}
+
+
+static int
+run_request (int argc, char **argv, const char *cwd, int fds[SERVE_FD_COUNT],
+             int saved[SERVE_FD_COUNT], int home_fd)
+{
+    /* run the command as if the client process had, in its directory and
+     * on its terminal */
+    int status = EXIT_FAILURE;
+
+    fflush (stdout);
+    fflush (stderr);
+    for (int i = 0; i < SERVE_FD_COUNT; i++) (void)dup2 (fds[i], i);
+    clearerr (stdin);
+
+    if (0 != chdir (cwd))
+    {
+        fprintf (stderr, "error: cannot enter directory '%s'\n", cwd);
+    }
+    else if (!mode_is_forwardable (argc, argv))
+    {
+        fprintf (stderr, "error: the daemon does not run this mode\n");
+    }
+    else
+    {
+        stats_begin ();
+        trace_begin ();
+        status = mode_run (argc, argv);
+        trace_end ();
+        stats_end (stderr);
+    }
+
+    fflush (stdout);
+    fflush (stderr);
+    discard_input (stdin);
+    for (int i = 0; i < SERVE_FD_COUNT; i++) (void)dup2 (saved[i], i);
+    (void)fchdir (home_fd);
+
+    return status;
+}
+
+
+static void
+handle_client (int client, int saved[SERVE_FD_COUNT], int home_fd,
+               bool verbose)
+{
+    serve_request_t request;
+    int fds[SERVE_FD_COUNT] = { -1, -1, -1 };
+    char *payload = NULL, *iter = NULL, *end = NULL;
+    char **argv = NULL;
+    int32_t status = EXIT_FAILURE;
+    struct timeval timeout = { SERVE_TIMEOUT, 0 };
+    uid_t uid;
+
+    /* only our own user may run commands as us */
+    if ((0 != peer_uid (client, &uid)) || (getuid () != uid))
+    {
+        if (verbose) fprintf (stderr, "rejected a request from another user\n");
+        return;
+    }
+
+    /* a client that connects and goes quiet must not hold up the rest */
+    (void)setsockopt (client, SOL_SOCKET, SO_RCVTIMEO, &timeout, 
+                      sizeof (timeout));
+    (void)setsockopt (client, SOL_SOCKET, SO_SNDTIMEO, &timeout, 
+                      sizeof (timeout));
+
+    if (0 != receive_request (client, &request, fds))
+    {
+        if (verbose) fprintf (stderr, "rejected a malformed request\n");
+        return;
+    }
+
+    payload = malloc (request.length);
+    argv    = malloc ((request.argc + 1) * sizeof (char *));
+    if ((NULL == payload) || (NULL == argv)
+     || (0 != read_all (client, payload, request.length)))
+    {
+        goto handle_client_exit;
+    }
+
+    /* split the payload, it must hold exactly the cwd and argc strings */
+    iter = payload;
+    end  = payload + request.length;
+    for (uint32_t i = 0; i <= request.argc; i++)
+    {
+        char *next = memchr (iter, '\0', end - iter);
+        if (NULL == next) goto handle_client_exit;
+
+        if (0 < i) argv[i - 1] = iter;
+        iter = next + 1;
+    }
+    if (iter != end) goto handle_client_exit;
+    argv[request.argc] = NULL;
+
+    if (verbose)
+    {
+        fprintf (stderr, "request: %s\n", (1 < request.argc ? argv[1] : ""));
+    }
+
+    status = run_request ((int)request.argc, argv, payload, fds, saved,
+                          home_fd);
+    (void)write_all (client, &status, sizeof (status));
+
+handle_client_exit:
+    for (int i = 0; i < SERVE_FD_COUNT; i++) close (fds[i]);
+    free (argv);    argv = NULL;
+    free (payload); payload = NULL;
+
+    return;
+}
+
+
+static int
+open_listener (const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat info;
+    mode_t mask;
+    int listener = -1;
+    int retcode = 0;
+
+    if (0 != make_address (path, &addr))
+    {
+        fprintf (stderr, "error: invalid socket path '%s'\n", path);
+        return -1;
+    }
+
+    /* never clobber anything but a stale socket */
+    if (0 == stat (path, &info))
+    {
+        int probe = -1;
+
+        if (!S_ISSOCK (info.st_mode))
+        {
+            fprintf (stderr, "error: '%s' exists and is not a socket\n", path);
+            return -1;
+        }
+
+        probe = socket (AF_UNIX, SOCK_STREAM, 0);
+        if ((0 <= probe)
+         && (0 == connect (probe, (struct sockaddr *)&addr, sizeof (addr))))
+        {
+            fprintf (stderr, "error: a daemon is already serving '%s'\n",
+                     path);
+            close (probe);
+            return -1;
+        }
+        if (0 <= probe) close (probe);
+        (void)unlink (path);
+    }
+
+    /* the socket is ours alone, from the moment it exists */
+    listener = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (0 <= listener)
+    {
+        mask = umask (S_IRWXG | S_IRWXO);
+        retcode = bind (listener, (struct sockaddr *)&addr, sizeof (addr));
+        (void)umask (mask);
+    }
+    if ((0 > listener) || (0 != retcode)
+     || (0 != chmod (path, S_IRUSR | S_IWUSR))
+     || (0 != listen (listener, SERVE_BACKLOG)))
+    {
+        fprintf (stderr, "error: cannot listen on '%s': %s\n", path,
+                 strerror (errno));
+        if (0 <= listener) close (listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+
+static void
+handle_stop (int signum)
+{
+    (void)signum;
+    s_stop = 1;
+}
+
+
+static int
+serve (settings_t settings)
+{
+    int retcode = -1;
+    const char *path = socket_path (&settings);
+    int listener = -1, client = -1, home_fd = -1;
+    int saved[SERVE_FD_COUNT] = { -1, -1, -1 };
+    char *previous_profile = NULL;
+    struct sigaction action;
+
+    if (NULL == path)
+    {
+        fprintf (stderr, "error: no socket to serve, set XDG_RUNTIME_DIR or "
+                 "HEMLOCK_SOCKET, or give --socket\n");
+        return -1;
+    }
+
+    /* a client hanging up mid reply must not take the daemon with it */
+    memset (&action, 0, sizeof (action));
+    action.sa_handler = SIG_IGN;
+    sigemptyset (&action.sa_mask);
+    (void)sigaction (SIGPIPE, &action, NULL);
+
+    /* no SA_RESTART, a signal should break out of accept () */
+    action.sa_handler = handle_stop;
+    (void)sigaction (SIGINT, &action, NULL);
+    (void)sigaction (SIGTERM, &action, NULL);
+
+#if !defined(HAVE___FPURGE) && !defined(HAVE_FPURGE)
+    /* nothing can drop what one request buffered, so buffer nothing */
+    (void)setvbuf (stdin, NULL, _IONBF, 0);
+#endif
+
+    /* requests borrow the standard streams, keep our own to return to */
+    home_fd = open (".", O_RDONLY);
+    for (int i = 0; i < SERVE_FD_COUNT; i++) saved[i] = dup (i);
+    if ((0 > home_fd) || (0 > saved[0]) || (0 > saved[1]) || (0 > saved[2]))
+    {
+        fprintf (stderr, "error: cannot save the working directory\n");
+        goto serve_exit;
+    }
+
+    listener = open_listener (path);
+    if (0 > listener) goto serve_exit;
+
+    /* connections, their statement caches and page caches outlive each
+     * request. requests without a --profile of their own take ours */
+    db_retain_connections (true);
+    previous_profile = settings_default_profile (settings.profile);
+    if (settings.verbose) fprintf (stderr, "serving on '%s'\n", path);
+
+    /* one request at a time, sqlite takes one writer at a time anyway */
+    while (!s_stop)
+    {
+        client = accept (listener, NULL, NULL);
+        if (0 > client)
+        {
+            if (EINTR == errno) continue;
+            fprintf (stderr, "error: accept failed: %s\n", strerror (errno));
+            break;
+        }
+
+        handle_client (client, saved, home_fd, settings.verbose);
+        close (client); client = -1;
+    }
+    retcode = (s_stop ? 0 : -1);
+
+    (void)settings_default_profile (previous_profile);
+    db_retain_connections (false);
+    close (listener);
+    (void)unlink (path);
+
+serve_exit:
+    for (int i = 0; i < SERVE_FD_COUNT; i++) if (0 <= saved[i]) close (saved[i]);
+    if (0 <= home_fd) close (home_fd);
+
+    return retcode;
+}
+
+
+static int
+get_field_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+
+    enum
+    {
+        SERVE_SOCKET = CONARG_ID_CUSTOM,
+        SERVE_PROFILE,
+        SERVE_DEBUG,
+        SERVE_VERBOSE,
+        SERVE_TERSE,
+        SERVE_HELP,
+    };
+
+    const conarg_t ARG_LIST[] =
+    {
+        { SERVE_SOCKET,  NULL, "--socket",  CONARG_PARAM_REQUIRED },
+        { SERVE_PROFILE, NULL, "--profile", CONARG_PARAM_REQUIRED },
+
+        { SERVE_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { SERVE_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { SERVE_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { SERVE_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+
+    int id;
+    conarg_status_t param_stat;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        switch (id)
+        {
+        case SERVE_SOCKET:
+            CONARG_STEP (argc, argv);
+            settings->socket = conarg_get_param (argc, argv);
+            break;
+
+        case SERVE_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case SERVE_DEBUG:
+            settings->debug   = true;
+            /* enable all verbose flags too */
+            /* fall through */
+        case SERVE_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case SERVE_TERSE:
+            settings->verbose = false;
+            break;
+
+        case SERVE_HELP:
+            log_serve_help (stdout);
+            return MODE_ARGS_HELP;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_serve_help (stderr);
+            return MODE_ARGS_ERROR;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static void
+log_serve_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " PROJECT_NAME " serve [OPTION]...\n"
+        "Serve insert, remove, search, owns and update requests over a unix\n"
+        "socket.\n"
+        "Egless otherwise specified assume -t flag,\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "      --socket PATH           listen on PATH instead of the default socket\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "      --debug                 log all (often unnecessary) information\n"
+        "  -v, --verbose               log extra information\n"
+        "  -t, --terse                 only log errors\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "The daemon keeps its database connections, prepared statements and page\n"
+        "caches open between requests. While it runs, other " PROJECT_NAME " commands\n"
+        "find the socket and hand their arguements, working directory and standard\n"
+        "streams to it instead of opening the database themselves. Requests are run\n"
+        "one at a time.\n"
+        "\n"
+        "The socket is the PATH given, or $HEMLOCK_SOCKET, or\n"
+        "'$XDG_RUNTIME_DIR/" HEMLOCK_SOCKET_FILE "'. Only its owner may use it, commands\n"
+        "ignore a socket another user owns and the daemon turns their requests away.\n"
+        "Setting HEMLOCK_SOCKET to an empty string stops commands using the daemon.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
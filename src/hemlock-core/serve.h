@@ -0,0 +1,25 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_SERVE_HEADER
+#define HEMLOCK_SERVE_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+/* usage: hemlock serve [--socket PATH]
+ * runs insert, remove, search and update requests from clients over a
+ * unix domain socket, with one long lived database connection. clients
+ * are the same binary, see serve_forward () */
+
+int serve_wrapper (int remaining, char **arg_iter);
+int serve_forward (int argc, char **argv, int *status_out);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
@@ -8,11 +8,44 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 
 static required_t settings_valid_fields (settings_t settings);
 static void fprintbits (FILE *fp, size_t n, uintmax_t v);
 
+/* the database modes use unless given --database */
+static char *s_default_database = HEMLOCK_DATABASE_FILE;
+
+/* the profile modes use unless given --profile, NULL defers to
+ * $HEMLOCK_PROFILE */
+static char *s_default_profile = NULL;
+
+
+char *
+settings_default_database (char *database)
+{
+    /* replaces the default database, returning the previous one. a batch
+     * uses this to point its commands at its own database */
+    char *previous = s_default_database;
+
+    s_default_database = ((NULL != database) ? database 
+                                             : HEMLOCK_DATABASE_FILE);
+    return previous;
+}
+
+
+char *
+settings_default_profile (char *profile)
+{
+    /* replaces the default profile, returning the previous one. a batch
+     * or the daemon uses this to hand its --profile to its commands */
+    char *previous = s_default_profile;
+
+    s_default_profile = profile;
+    return previous;
+}
+
 
 settings_t 
 settings_default (void)
@@ -20,22 +53,52 @@ settings_default (void)
     settings_t settings;
 
     settings.debug   = false;
+    settings.stats   = false;
+
+    settings.trace_file = NULL;
+    settings.slow_query = 0.0;
     settings.verbose = false;
 
-    settings.database = HEMLOCK_DATABASE_FILE;
+    settings.database = s_default_database;
+    settings.socket   = NULL;
+    settings.profile  = s_default_profile;
     settings.dry_run  = false;
+    settings.upsert   = false;
+
+    settings.like_search     = false;
+    settings.list_requires   = false;
+    settings.list_dependants = false;
+    settings.list_latest     = false;
+    settings.list_upgradable = false;
+
+    settings.cascade = false;
+    settings.force   = false;
+
+    settings.commit_every = 0;
+    settings.keep_going   = false;
 
     settings.name         = NULL;
     settings.version      = NULL;
+    settings.new_name     = NULL;
+    settings.new_version  = NULL;
     settings.homepage     = NULL;
     settings.maintainer   = NULL;
     settings.email        = NULL;
     settings.require_list = NULL;
     settings.file_list    = NULL;
+    settings.from_file    = NULL;
+    settings.files_from   = NULL;
+    settings.paths        = NULL;
+    settings.path_count   = 0;
+
+    settings.null_separated = false;
 
     settings.as_dependency = false;
     settings.is_installed  = true;    
 
+    settings.as_dependency_given = false;
+    settings.is_installed_given  = false;
+
     return settings;
 }
 
@@ -54,16 +117,37 @@ void
 settings_print (FILE *fp, settings_t settings)
 {    
     fprintf (fp, "debug:         %d\n", settings.debug);
+    fprintf (fp, "stats:         %d\n", settings.stats);
+    fprintf (fp, "trace_file:    %s\n", settings.trace_file);
+    fprintf (fp, "slow_query:    %g\n", settings.slow_query);
     fprintf (fp, "verbose:       %d\n", settings.verbose);
     fprintf (fp, "database:      %s\n", settings.database);
+    fprintf (fp, "socket:        %s\n", settings.socket);
+    fprintf (fp, "profile:       %s\n", settings.profile);
     fprintf (fp, "dry_run:       %d\n", settings.dry_run);
+    fprintf (fp, "upsert:        %d\n", settings.upsert);
+    fprintf (fp, "like_search:   %d\n", settings.like_search);
+    fprintf (fp, "requires:      %d\n", settings.list_requires);
+    fprintf (fp, "dependants:    %d\n", settings.list_dependants);
+    fprintf (fp, "latest:        %d\n", settings.list_latest);
+    fprintf (fp, "upgradable:    %d\n", settings.list_upgradable);
+    fprintf (fp, "cascade:       %d\n", settings.cascade);
+    fprintf (fp, "force:         %d\n", settings.force);
+    fprintf (fp, "commit_every:  %zu\n", settings.commit_every);
+    fprintf (fp, "keep_going:    %d\n", settings.keep_going);
     fprintf (fp, "name:          %s\n", settings.name);
     fprintf (fp, "version:       %s\n", settings.version);
+    fprintf (fp, "new_name:      %s\n", settings.new_name);
+    fprintf (fp, "new_version:   %s\n", settings.new_version);
     fprintf (fp, "homepage:      %s\n", settings.homepage);
     fprintf (fp, "maintainer:    %s\n", settings.maintainer);
     fprintf (fp, "email:         %s\n", settings.email);
     fprintf (fp, "require_list:  %s\n", settings.require_list);
     fprintf (fp, "file_list:     %s\n", settings.file_list);
+    fprintf (fp, "from_file:     %s\n", settings.from_file);
+    fprintf (fp, "files_from:    %s\n", settings.files_from);
+    fprintf (fp, "path_count:    %zu\n", settings.path_count);
+    fprintf (fp, "null_sep:      %d\n", settings.null_separated);
     fprintf (fp, "as_dependency: %d\n", settings.as_dependency);
     fprintf (fp, "is_installed:  %d\n", settings.is_installed);
     fprintf (fp, "valid_fields:  ");
@@ -93,6 +177,25 @@ settings_valid_fields (settings_t settings)
 }
 
 
+int
+settings_set_slow_query (settings_t *settings, const char *milliseconds)
+{
+    /* a threshold in milliseconds, fractions allowed */
+    char *end = NULL;
+    double value = strtod (milliseconds, &end);
+
+    if (('\0' == *milliseconds) || ('\0' != *end) || !(0.0 < value))
+    {
+        fprintf (stderr, "error: invalid slow query threshold '%s'\n",
+                 milliseconds);
+        return -1;
+    }
+
+    settings->slow_query = value;
+    return 0;
+}
+
+
 required_t
 settings_validate (settings_t settings, required_t require)
 {
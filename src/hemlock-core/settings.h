@@ -10,6 +10,7 @@ extern "C" {
 /* code start */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -17,18 +18,42 @@ extern "C" {
 typedef struct
 {
     char *database;
+    char *socket;
+    char *profile;
     char *name;
     char *version;
+    char *new_name;
+    char *new_version;
     char *homepage;
     char *maintainer;
     char *email;
     char *require_list;
     char *file_list;
+    char *from_file;
+    char *files_from;
+    char **paths;
+    char *trace_file;
+    size_t commit_every;
+    size_t path_count;
+    double slow_query;
     bool dry_run;
+    bool upsert;
+    bool null_separated;
+    bool like_search;
+    bool list_requires;
+    bool list_dependants;
+    bool list_latest;
+    bool list_upgradable;
+    bool cascade;
+    bool force;
+    bool keep_going;
     bool debug;
+    bool stats;
     bool verbose;
     bool as_dependency;
     bool is_installed;
+    bool as_dependency_given;
+    bool is_installed_given;
 } settings_t;
 
 const enum
@@ -48,7 +73,10 @@ typedef uint32_t required_t;
 
 
 settings_t settings_default (void);
+char *settings_default_database (char *database);
+char *settings_default_profile (char *profile);
 void settings_print (FILE *fp, settings_t settings);
+int settings_set_slow_query (settings_t *settings, const char *milliseconds);
 required_t settings_validate (settings_t settings, required_t require);
 void settings_log_required (FILE *fp, required_t missing);
 
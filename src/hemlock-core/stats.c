@@ -0,0 +1,624 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "stats.h"
+
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+#define STATS_VFS_NAME "hemlock-stats"
+
+static const char *PHASE_NAMES[STATS_PHASE_COUNT] =
+{
+    [STATS_PHASE_ARGS]   = "args",
+    [STATS_PHASE_OPEN]   = "open",
+    [STATS_PHASE_SCHEMA] = "schema",
+    [STATS_PHASE_QUERY]  = "query",
+    [STATS_PHASE_OUTPUT] = "output",
+};
+
+/* counters of the command in progress */
+static struct
+{
+    bool enabled;
+    stats_phase_t phase;
+    double begin;
+    double phase_begin;
+    double phase_seconds[STATS_PHASE_COUNT];
+    clock_t cpu_begin;
+    sqlite3_int64 statements;
+    sqlite3_int64 rows;
+    sqlite3_int64 cache_hits;
+    sqlite3_int64 cache_misses;
+    sqlite3_int64 cache_writes;
+    sqlite3_int64 cache_spills;
+    sqlite3_int64 busy;
+    sqlite3_int64 reads;
+    sqlite3_int64 read_bytes;
+    sqlite3_int64 writes;
+    sqlite3_int64 write_bytes;
+    sqlite3_int64 syncs;
+    double io_seconds;
+} s_stats;
+
+/* a file of the counting vfs, the real file follows it in memory */
+typedef struct
+{
+    sqlite3_file base;
+    sqlite3_file *real;
+} stats_file_t;
+
+static sqlite3_vfs s_vfs;
+static bool s_vfs_registered = false;
+
+
+static double now (void);
+static int busy_count (void *context, int count);
+static void log_report (FILE *fp, double wall, double cpu);
+
+static int file_close (sqlite3_file *file);
+static int file_read (sqlite3_file *file, void *buffer, int n,
+                      sqlite3_int64 offset);
+static int file_write (sqlite3_file *file, const void *buffer, int n,
+                       sqlite3_int64 offset);
+static int file_truncate (sqlite3_file *file, sqlite3_int64 size);
+static int file_sync (sqlite3_file *file, int flags);
+static int file_size (sqlite3_file *file, sqlite3_int64 *size_out);
+static int file_lock (sqlite3_file *file, int lock);
+static int file_unlock (sqlite3_file *file, int lock);
+static int file_check_reserved_lock (sqlite3_file *file, int *result_out);
+static int file_control (sqlite3_file *file, int op, void *arg);
+static int file_sector_size (sqlite3_file *file);
+static int file_device_characteristics (sqlite3_file *file);
+static int file_shm_map (sqlite3_file *file, int page, int page_size,
+                         int extend, void volatile **map_out);
+static int file_shm_lock (sqlite3_file *file, int offset, int n, int flags);
+static void file_shm_barrier (sqlite3_file *file);
+static int file_shm_unmap (sqlite3_file *file, int delete_flag);
+static int file_fetch (sqlite3_file *file, sqlite3_int64 offset, int n,
+                       void **page_out);
+static int file_unfetch (sqlite3_file *file, sqlite3_int64 offset,
+                         void *page);
+
+static int vfs_open (sqlite3_vfs *vfs, const char *name, sqlite3_file *file,
+                     int flags, int *flags_out);
+static int vfs_delete (sqlite3_vfs *vfs, const char *name, int sync_dir);
+static int vfs_access (sqlite3_vfs *vfs, const char *name, int flags,
+                       int *result_out);
+static int vfs_full_pathname (sqlite3_vfs *vfs, const char *name, int n,
+                              char *out);
+static void *vfs_dl_open (sqlite3_vfs *vfs, const char *filename);
+static void vfs_dl_error (sqlite3_vfs *vfs, int n, char *message);
+static void (*vfs_dl_sym (sqlite3_vfs *vfs, void *handle,
+                          const char *symbol)) (void);
+static void vfs_dl_close (sqlite3_vfs *vfs, void *handle);
+static int vfs_randomness (sqlite3_vfs *vfs, int n, char *out);
+static int vfs_sleep (sqlite3_vfs *vfs, int microseconds);
+static int vfs_current_time (sqlite3_vfs *vfs, double *time_out);
+static int vfs_get_last_error (sqlite3_vfs *vfs, int n, char *message);
+static int vfs_current_time_int64 (sqlite3_vfs *vfs, sqlite3_int64 *time_out);
+
+
+/* the real file's methods decide which of these a file gets */
+#define STATS_IO_METHODS(version) \
+    { \
+        version, file_close, file_read, file_write, file_truncate, \
+        file_sync, file_size, file_lock, file_unlock, \
+        file_check_reserved_lock, file_control, file_sector_size, \
+        file_device_characteristics, file_shm_map, file_shm_lock, \
+        file_shm_barrier, file_shm_unmap, file_fetch, file_unfetch \
+    }
+static const sqlite3_io_methods IO_METHODS[] =
+{
+    STATS_IO_METHODS (1),
+    STATS_IO_METHODS (2),
+    STATS_IO_METHODS (3),
+};
+#define IO_METHODS_COUNT ((int)(sizeof (IO_METHODS) / sizeof (*IO_METHODS)))
+
+#define REAL_FILE(file) (((stats_file_t *)(file))->real)
+#define REAL_VFS(vfs)   ((sqlite3_vfs *)((vfs)->pAppData))
+
+
+static double
+now (void)
+{
+    struct timespec ts;
+
+    (void)timespec_get (&ts, TIME_UTC);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+
+void
+stats_begin (void)
+{
+    sqlite3_int64 current = 0, highwater = 0;
+
+    memset (&s_stats, 0, sizeof (s_stats));
+    s_stats.phase       = STATS_PHASE_ARGS;
+    s_stats.begin       = now ();
+    s_stats.phase_begin = s_stats.begin;
+    s_stats.cpu_begin   = clock ();
+
+    /* restart the peak, a daemon runs many commands */
+    (void)sqlite3_status64 (SQLITE_STATUS_MEMORY_USED, &current, &highwater, 1);
+}
+
+
+void
+stats_enable (void)
+{
+    s_stats.enabled = true;
+}
+
+
+bool
+stats_enabled (void)
+{
+    return s_stats.enabled;
+}
+
+
+stats_phase_t
+stats_phase (stats_phase_t phase)
+{
+    stats_phase_t previous = s_stats.phase;
+    double time = 0.0;
+
+    /* until enabled the first phase runs on, it is charged once --stats
+     * has been read */
+    if (!s_stats.enabled) return previous;
+
+    time = now ();
+    s_stats.phase_seconds[previous] += time - s_stats.phase_begin;
+    s_stats.phase_begin = time;
+    s_stats.phase = phase;
+
+    return previous;
+}
+
+
+void
+stats_end (FILE *fp)
+{
+    double wall = 0.0, cpu = 0.0;
+
+    if (!s_stats.enabled) return;
+
+    (void)stats_phase (s_stats.phase);
+    wall = now () - s_stats.begin;
+    cpu  = (double)(clock () - s_stats.cpu_begin) / CLOCKS_PER_SEC;
+
+    log_report (fp, wall, cpu);
+    s_stats.enabled = false;
+}
+
+
+static void
+log_report (FILE *fp, double wall, double cpu)
+{
+    sqlite3_int64 memory = 0, memory_peak = 0;
+
+    (void)sqlite3_status64 (SQLITE_STATUS_MEMORY_USED, &memory, &memory_peak,
+                            0);
+
+    fprintf (fp, "stats: wall %.3f ms, cpu %.3f ms\n", wall * 1e3, cpu * 1e3);
+    fprintf (fp, "stats: phases:");
+    for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        fprintf (fp, " %s %.3f%s", PHASE_NAMES[i],
+                 s_stats.phase_seconds[i] * 1e3,
+                 ((STATS_PHASE_COUNT - 1 == i) ? " ms\n" : ","));
+    }
+    fprintf (fp, "stats: sql: %lld statements, %lld rows\n",
+             (long long)s_stats.statements, (long long)s_stats.rows);
+    fprintf (fp, "stats: memory: %lld bytes peak, %lld bytes held\n",
+             (long long)memory_peak, (long long)memory);
+    fprintf (fp, "stats: page cache: %lld hits, %lld misses, %lld writes, "
+             "%lld spills\n", (long long)s_stats.cache_hits,
+             (long long)s_stats.cache_misses, (long long)s_stats.cache_writes,
+             (long long)s_stats.cache_spills);
+    fprintf (fp, "stats: io: %lld reads (%lld bytes), %lld writes "
+             "(%lld bytes), %lld syncs, %.3f ms\n", (long long)s_stats.reads,
+             (long long)s_stats.read_bytes, (long long)s_stats.writes,
+             (long long)s_stats.write_bytes, (long long)s_stats.syncs,
+             s_stats.io_seconds * 1e3);
+    fprintf (fp, "stats: locks: %lld busy\n", (long long)s_stats.busy);
+    fflush (fp);
+}
+
+
+unsigned
+stats_trace_mask (void)
+{
+    if (!s_stats.enabled) return 0;
+    return SQLITE_TRACE_STMT | SQLITE_TRACE_ROW;
+}
+
+
+void
+stats_trace (unsigned type, void *p, void *x)
+{
+    /* statements run by triggers are part of the one that fired them */
+    (void)p;
+
+    if (!s_stats.enabled) return;
+
+    if ((SQLITE_TRACE_STMT == type) && (0 != strncmp (x, "--", 2)))
+    {
+        s_stats.statements++;
+    }
+    else if (SQLITE_TRACE_ROW == type)
+    {
+        s_stats.rows++;
+    }
+}
+
+
+static int
+busy_count (void *context, int count)
+{
+    /* counts the lock conflicts, but gives up at once as before */
+    (void)context;
+    (void)count;
+
+    s_stats.busy++;
+    return 0;
+}
+
+
+void
+stats_attach (sqlite3 *db)
+{
+    /* a pooled connection may have been counting for an earlier command */
+    (void)sqlite3_busy_handler (db, (s_stats.enabled ? busy_count : NULL),
+                                NULL);
+}
+
+
+void
+stats_detach (sqlite3 *db)
+{
+    /* collects the page cache counters, and resets them for whoever
+     * uses the connection next */
+    const struct { int op; sqlite3_int64 *total; } COUNTERS[] =
+    {
+        { SQLITE_DBSTATUS_CACHE_HIT,   &s_stats.cache_hits },
+        { SQLITE_DBSTATUS_CACHE_MISS,  &s_stats.cache_misses },
+        { SQLITE_DBSTATUS_CACHE_WRITE, &s_stats.cache_writes },
+        { SQLITE_DBSTATUS_CACHE_SPILL, &s_stats.cache_spills },
+    };
+    const size_t COUNTER_COUNT = sizeof (COUNTERS) / sizeof (*COUNTERS);
+    int current = 0, highwater = 0;
+
+    if (!s_stats.enabled) return;
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        if (SQLITE_OK == sqlite3_db_status (db, COUNTERS[i].op, &current,
+                                            &highwater, 1))
+        {
+            *(COUNTERS[i].total) += current;
+        }
+    }
+}
+
+
+const char *
+stats_vfs (void)
+{
+    /* wraps the default vfs, counting and timing the io through it */
+    sqlite3_vfs *real = NULL;
+
+    if (!s_stats.enabled) return NULL;
+    if (s_vfs_registered) return STATS_VFS_NAME;
+
+    real = sqlite3_vfs_find (NULL);
+    if (NULL == real) return NULL;
+
+    memset (&s_vfs, 0, sizeof (s_vfs));
+    s_vfs.iVersion   = (2 < real->iVersion) ? 2 : real->iVersion;
+    s_vfs.szOsFile   = (int)sizeof (stats_file_t) + real->szOsFile;
+    s_vfs.mxPathname = real->mxPathname;
+    s_vfs.zName      = STATS_VFS_NAME;
+    s_vfs.pAppData   = real;
+    s_vfs.xOpen         = vfs_open;
+    s_vfs.xDelete       = vfs_delete;
+    s_vfs.xAccess       = vfs_access;
+    s_vfs.xFullPathname = vfs_full_pathname;
+    s_vfs.xDlOpen       = vfs_dl_open;
+    s_vfs.xDlError      = vfs_dl_error;
+    s_vfs.xDlSym        = vfs_dl_sym;
+    s_vfs.xDlClose      = vfs_dl_close;
+    s_vfs.xRandomness   = vfs_randomness;
+    s_vfs.xSleep        = vfs_sleep;
+    s_vfs.xCurrentTime  = vfs_current_time;
+    s_vfs.xGetLastError = vfs_get_last_error;
+    s_vfs.xCurrentTimeInt64 = vfs_current_time_int64;
+
+    if (SQLITE_OK != sqlite3_vfs_register (&s_vfs, 0)) return NULL;
+    s_vfs_registered = true;
+
+    return STATS_VFS_NAME;
+}
+
+
+static int
+vfs_open (sqlite3_vfs *vfs, const char *name, sqlite3_file *file, int flags,
+          int *flags_out)
+{
+    stats_file_t *stats_file = (stats_file_t *)file;
+    const sqlite3_io_methods *methods = NULL;
+    int version, retcode;
+
+    stats_file->base.pMethods = NULL;
+    stats_file->real = (sqlite3_file *)(stats_file + 1);
+
+    retcode = REAL_VFS (vfs)->xOpen (REAL_VFS (vfs), name, stats_file->real,
+                                     flags, flags_out);
+
+    /* a file without methods needs no close, keep it that way */
+    methods = stats_file->real->pMethods;
+    if (NULL != methods)
+    {
+        version = methods->iVersion;
+        if (IO_METHODS_COUNT < version) version = IO_METHODS_COUNT;
+        if (1 > version) version = 1;
+        stats_file->base.pMethods = &IO_METHODS[version - 1];
+    }
+
+    return retcode;
+}
+
+
+static int
+vfs_delete (sqlite3_vfs *vfs, const char *name, int sync_dir)
+{
+    return REAL_VFS (vfs)->xDelete (REAL_VFS (vfs), name, sync_dir);
+}
+
+
+static int
+vfs_access (sqlite3_vfs *vfs, const char *name, int flags, int *result_out)
+{
+    return REAL_VFS (vfs)->xAccess (REAL_VFS (vfs), name, flags, result_out);
+}
+
+
+static int
+vfs_full_pathname (sqlite3_vfs *vfs, const char *name, int n, char *out)
+{
+    return REAL_VFS (vfs)->xFullPathname (REAL_VFS (vfs), name, n, out);
+}
+
+
+static void *
+vfs_dl_open (sqlite3_vfs *vfs, const char *filename)
+{
+    return REAL_VFS (vfs)->xDlOpen (REAL_VFS (vfs), filename);
+}
+
+
+static void
+vfs_dl_error (sqlite3_vfs *vfs, int n, char *message)
+{
+    REAL_VFS (vfs)->xDlError (REAL_VFS (vfs), n, message);
+}
+
+
+static void
+(*vfs_dl_sym (sqlite3_vfs *vfs, void *handle, const char *symbol)) (void)
+{
+    return REAL_VFS (vfs)->xDlSym (REAL_VFS (vfs), handle, symbol);
+}
+
+
+static void
+vfs_dl_close (sqlite3_vfs *vfs, void *handle)
+{
+    REAL_VFS (vfs)->xDlClose (REAL_VFS (vfs), handle);
+}
+
+
+static int
+vfs_randomness (sqlite3_vfs *vfs, int n, char *out)
+{
+    return REAL_VFS (vfs)->xRandomness (REAL_VFS (vfs), n, out);
+}
+
+
+static int
+vfs_sleep (sqlite3_vfs *vfs, int microseconds)
+{
+    return REAL_VFS (vfs)->xSleep (REAL_VFS (vfs), microseconds);
+}
+
+
+static int
+vfs_current_time (sqlite3_vfs *vfs, double *time_out)
+{
+    return REAL_VFS (vfs)->xCurrentTime (REAL_VFS (vfs), time_out);
+}
+
+
+static int
+vfs_get_last_error (sqlite3_vfs *vfs, int n, char *message)
+{
+    if (NULL == REAL_VFS (vfs)->xGetLastError) return 0;
+    return REAL_VFS (vfs)->xGetLastError (REAL_VFS (vfs), n, message);
+}
+
+
+static int
+vfs_current_time_int64 (sqlite3_vfs *vfs, sqlite3_int64 *time_out)
+{
+    return REAL_VFS (vfs)->xCurrentTimeInt64 (REAL_VFS (vfs), time_out);
+}
+
+
+static int
+file_close (sqlite3_file *file)
+{
+    return REAL_FILE (file)->pMethods->xClose (REAL_FILE (file));
+}
+
+
+static int
+file_read (sqlite3_file *file, void *buffer, int n, sqlite3_int64 offset)
+{
+    double begin = now ();
+    int retcode = REAL_FILE (file)->pMethods->xRead (REAL_FILE (file), buffer,
+                                                     n, offset);
+
+    s_stats.io_seconds += now () - begin;
+    s_stats.reads++;
+    s_stats.read_bytes += n;
+
+    return retcode;
+}
+
+
+static int
+file_write (sqlite3_file *file, const void *buffer, int n,
+            sqlite3_int64 offset)
+{
+    double begin = now ();
+    int retcode = REAL_FILE (file)->pMethods->xWrite (REAL_FILE (file),
+                                                      buffer, n, offset);
+
+    s_stats.io_seconds += now () - begin;
+    s_stats.writes++;
+    s_stats.write_bytes += n;
+
+    return retcode;
+}
+
+
+static int
+file_truncate (sqlite3_file *file, sqlite3_int64 size)
+{
+    return REAL_FILE (file)->pMethods->xTruncate (REAL_FILE (file), size);
+}
+
+
+static int
+file_sync (sqlite3_file *file, int flags)
+{
+    double begin = now ();
+    int retcode = REAL_FILE (file)->pMethods->xSync (REAL_FILE (file), flags);
+
+    s_stats.io_seconds += now () - begin;
+    s_stats.syncs++;
+
+    return retcode;
+}
+
+
+static int
+file_size (sqlite3_file *file, sqlite3_int64 *size_out)
+{
+    return REAL_FILE (file)->pMethods->xFileSize (REAL_FILE (file), size_out);
+}
+
+
+static int
+file_lock (sqlite3_file *file, int lock)
+{
+    return REAL_FILE (file)->pMethods->xLock (REAL_FILE (file), lock);
+}
+
+
+static int
+file_unlock (sqlite3_file *file, int lock)
+{
+    return REAL_FILE (file)->pMethods->xUnlock (REAL_FILE (file), lock);
+}
+
+
+static int
+file_check_reserved_lock (sqlite3_file *file, int *result_out)
+{
+    return REAL_FILE (file)->pMethods->xCheckReservedLock (REAL_FILE (file),
+                                                           result_out);
+}
+
+
+static int
+file_control (sqlite3_file *file, int op, void *arg)
+{
+    return REAL_FILE (file)->pMethods->xFileControl (REAL_FILE (file), op,
+                                                     arg);
+}
+
+
+static int
+file_sector_size (sqlite3_file *file)
+{
+    return REAL_FILE (file)->pMethods->xSectorSize (REAL_FILE (file));
+}
+
+
+static int
+file_device_characteristics (sqlite3_file *file)
+{
+    return REAL_FILE (file)->pMethods->xDeviceCharacteristics (
+            REAL_FILE (file));
+}
+
+
+static int
+file_shm_map (sqlite3_file *file, int page, int page_size, int extend,
+              void volatile **map_out)
+{
+    return REAL_FILE (file)->pMethods->xShmMap (REAL_FILE (file), page,
+                                                page_size, extend, map_out);
+}
+
+
+static int
+file_shm_lock (sqlite3_file *file, int offset, int n, int flags)
+{
+    return REAL_FILE (file)->pMethods->xShmLock (REAL_FILE (file), offset, n,
+                                                 flags);
+}
+
+
+static void
+file_shm_barrier (sqlite3_file *file)
+{
+    REAL_FILE (file)->pMethods->xShmBarrier (REAL_FILE (file));
+}
+
+
+static int
+file_shm_unmap (sqlite3_file *file, int delete_flag)
+{
+    return REAL_FILE (file)->pMethods->xShmUnmap (REAL_FILE (file),
+                                                  delete_flag);
+}
+
+
+static int
+file_fetch (sqlite3_file *file, sqlite3_int64 offset, int n, void **page_out)
+{
+    return REAL_FILE (file)->pMethods->xFetch (REAL_FILE (file), offset, n,
+                                               page_out);
+}
+
+
+static int
+file_unfetch (sqlite3_file *file, sqlite3_int64 offset, void *page)
+{
+    return REAL_FILE (file)->pMethods->xUnfetch (REAL_FILE (file), offset,
+                                                 page);
+}
+
+
+/* end of file */
@@ -0,0 +1,54 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_STATS_HEADER
+#define HEMLOCK_STATS_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+
+/* where the wall time of a command goes, see stats_phase () */
+typedef enum
+{
+    STATS_PHASE_ARGS,
+    STATS_PHASE_OPEN,
+    STATS_PHASE_SCHEMA,
+    STATS_PHASE_QUERY,
+    STATS_PHASE_OUTPUT,
+    STATS_PHASE_COUNT
+} stats_phase_t;
+
+
+/* one command runs between stats_begin () and stats_end (), which reports
+ * on fp if --stats turned the counters on in between */
+void stats_begin (void);
+void stats_end (FILE *fp);
+void stats_enable (void);
+bool stats_enabled (void);
+
+/* charges the time since the last switch to the current phase, and makes
+ * phase current. returns the phase it replaced, to switch back to */
+stats_phase_t stats_phase (stats_phase_t phase);
+
+/* the sqlite3_trace_v2 () events stats_trace () counts, 0 while disabled */
+unsigned stats_trace_mask (void);
+void stats_trace (unsigned type, void *p, void *x);
+
+/* the counting vfs to open connections with, NULL while disabled */
+const char *stats_vfs (void);
+void stats_attach (sqlite3 *db);
+void stats_detach (sqlite3 *db);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
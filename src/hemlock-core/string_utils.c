@@ -51,11 +51,201 @@ substring_clone (const char *src, size_t n)
 }
 
 
+void
+string_builder_init (string_builder_t *builder)
+{
+    builder->data   = NULL;
+    builder->length = 0;
+    builder->alloc  = 0;
+    builder->failed = false;
+}
+
+
+void
+string_builder_reset (string_builder_t *builder)
+{
+    /* empties the builder, keeping its buffer for the next string */
+    builder->length = 0;
+    builder->failed = false;
+    if (NULL != builder->data) builder->data[0] = '\0';
+}
+
+
+void
+string_builder_free (string_builder_t *builder)
+{
+    free (builder->data);
+    string_builder_init (builder);
+}
+
+
+int
+string_builder_reserve (string_builder_t *builder, size_t n)
+{
+    /* makes room for n more characters and the terminator */
+    void *temp = NULL;
+    size_t alloc = builder->alloc;
+
+    if (builder->failed) return -1;
+    if ((builder->length + n) < builder->alloc) return 0;
+
+    if (0 == alloc) alloc = 64;
+    while ((builder->length + n) >= alloc) alloc *= 2;
+
+    temp = realloc (builder->data, alloc);
+    if (NULL == temp)
+    {
+        builder->failed = true;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    builder->data  = temp; temp = NULL;
+    builder->alloc = alloc;
+    builder->data[builder->length] = '\0';
+
+    return 0;
+}
+
+
+int
+string_builder_append_n (string_builder_t *builder, const char *src, 
+                         size_t n)
+{
+    if (0 != string_builder_reserve (builder, n)) return -1;
+
+    memcpy (builder->data + builder->length, src, n);
+    builder->length += n;
+    builder->data[builder->length] = '\0';
+
+    return 0;
+}
+
+
+int
+string_builder_append (string_builder_t *builder, const char *src)
+{
+    if (NULL == src)
+    {
+        builder->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+
+    return string_builder_append_n (builder, src, strlen (src));
+}
+
+
+int
+string_builder_append_char (string_builder_t *builder, char c)
+{
+    return string_builder_append_n (builder, &c, 1);
+}
+
+
+int
+string_builder_append_escaped (string_builder_t *builder, const char *src,
+                               char quote)
+{
+    /* src between quotes, with the quotes inside it doubled as sql does.
+     * NULL is appended as the sql NULL. escaped straight into the spare
+     * room of the buffer, growing it only when that is too small */
+    size_t room = 0, length = 0;
+
+    if (NULL == src) return string_builder_append (builder, "NULL");
+    if (builder->failed) return -1;
+
+    room   = builder->alloc - builder->length;
+    length = string_escape (((0 < room) ? builder->data + builder->length 
+                                        : NULL), room, src, quote);
+    if (length >= room)
+    {
+        if (0 != string_builder_reserve (builder, length)) return -1;
+        (void)string_escape (builder->data + builder->length, 
+                             builder->alloc - builder->length, src, quote);
+    }
+
+    builder->length += length;
+    return 0;
+}
+
+
+int
+string_builder_append_int (string_builder_t *builder, int n)
+{
+    /* a sign and a digit for every 3 bits is always enough */
+    char digits[(sizeof (int) * 3) + 2];
+    int length = snprintf (digits, sizeof (digits), "%d", n);
+
+    return string_builder_append_n (builder, digits, (size_t)length);
+}
+
+
 char *
-string_join (char **array, size_t n, char *seperator)
+string_builder_finish (string_builder_t *builder)
 {
+    /* hands the string to the caller, to free, and empties the builder */
     char *dest = NULL;
-    size_t dest_len = 0;
+
+    if ((0 != string_builder_reserve (builder, 0)) || (builder->failed))
+    {
+        string_builder_free (builder);
+        return NULL;
+    }
+
+    dest = builder->data;
+    string_builder_init (builder);
+
+    return dest;
+}
+
+
+size_t
+string_escape (char *dest, size_t size, const char *src, char quote)
+{
+    /* writes src between quotes into dest, doubling the quotes inside it,
+     * and returns the length that takes without the terminator. nothing
+     * but the terminator is written unless all of it fits in size. text
+     * without a quote, nearly all of it, is found by one memchr and copied
+     * by one memcpy */
+    size_t n = strlen (src), length = n + 2, run = 0;
+    const char *iter = src, *end = src + n, *found = NULL;
+
+    for (found = memchr (iter, quote, n); NULL != found; 
+         found = memchr (found + 1, quote, end - (found + 1)))
+    {
+        length++;
+    }
+
+    if (length >= size)
+    {
+        if (0 < size) dest[0] = '\0';
+        return length;
+    }
+
+    *(dest++) = quote;
+    while (NULL != (found = memchr (iter, quote, end - iter)))
+    {
+        run = (found - iter) + 1;
+        (void)memcpy (dest, iter, run);
+        dest += run;
+        *(dest++) = quote;
+        iter = found + 1;
+    }
+    (void)memcpy (dest, iter, end - iter);
+    dest += end - iter;
+    *(dest++) = quote;
+    *dest = '\0';
+
+    return length;
+}
+
+
+char *
+string_join (char **array, size_t n, char *seperator)
+{
+    string_builder_t builder;
+    size_t dest_len = 0, seperator_len = 0;
 
     if ((NULL == array) || (NULL == seperator) || (0 == n))
     {
@@ -73,22 +263,24 @@ string_join (char **array, size_t n, char *seperator)
         dest_len += strlen (array[i]);
     }
 
-    dest_len += (strlen (seperator) * (n - 1));
-
-    dest = calloc (dest_len + 1, sizeof (char));
-    if (NULL == dest)
-    {
-        return NULL;
-    }
+    seperator_len = strlen (seperator);
+    dest_len += (seperator_len * (n - 1));
 
+    /* sized once, so every piece is copied exactly once */
+    string_builder_init (&builder);
+    (void)string_builder_reserve (&builder, dest_len);
     for (size_t i = 0; i < n; i++)
     {
-        (void)strcat (dest, array[i]);
+        (void)string_builder_append (&builder, array[i]);
 
-        if ((i + 1) < n) (void)strcat (dest, seperator);
+        if ((i + 1) < n) 
+        {
+            (void)string_builder_append_n (&builder, seperator, 
+                                           seperator_len);
+        }
     }
 
-    return dest;
+    return string_builder_finish (&builder);
 }
 
 
@@ -169,34 +361,40 @@ string_split_exit:
 char *
 string_replace (char *src, char *find, char *replace)
 {
-    char *dest = NULL, **split_array = NULL;
-    size_t n = 0;
+    string_builder_t builder;
+    const char *start = src, *end = NULL;
+    size_t find_len = 0, replace_len = 0;
 
-    if ((NULL == src) || (NULL == find))
+    if ((NULL == src) || (NULL == find) || (NULL == replace) 
+     || ('\0' == *find))
     {
         errno = EINVAL;
         return NULL;
     }
 
-    split_array = string_split (src, find, &n);
-    if (NULL == split_array) goto string_replace_exit; 
-    
-    dest = string_join (split_array, n, replace);
+    find_len    = strlen (find);
+    replace_len = strlen (replace);
 
-    for (int i = 0; i < n; i++) free (split_array[i]);
-    free (split_array);
+    /* copy the text between matches straight into the result */
+    string_builder_init (&builder);
+    (void)string_builder_reserve (&builder, strlen (src));
+    while (NULL != (end = strstr (start, find)))
+    {
+        (void)string_builder_append_n (&builder, start, end - start);
+        (void)string_builder_append_n (&builder, replace, replace_len);
+        start = end + find_len;
+    }
+    (void)string_builder_append (&builder, start);
 
-string_replace_exit:
-    return dest;
+    return string_builder_finish (&builder);
 }
 
 
 char *
 string_quote (char *base, char *quote)
 {
-
-    char *dest = NULL;
-    size_t quote_size = 0, base_size = 0, dest_size = 0;
+    string_builder_t builder;
+    size_t quote_size = 0, base_size = 0;
 
     if ((NULL == base) || (NULL == quote)) 
     {
@@ -206,20 +404,15 @@ string_quote (char *base, char *quote)
 
     base_size  = strlen (base);
     quote_size = strlen (quote);
-    dest_size  = quote_size + base_size + quote_size;
-
-    dest = calloc (dest_size + 1, sizeof (char));
-    if (NULL == dest)
-    {
-        errno = ENOMEM;
-        return NULL;
-    }
 
-    (void)strcat (dest, quote);
-    (void)strcat (dest, base);
-    (void)strcat (dest, quote);
+    string_builder_init (&builder);
+    (void)string_builder_reserve (&builder, 
+                                  quote_size + base_size + quote_size);
+    (void)string_builder_append_n (&builder, quote, quote_size);
+    (void)string_builder_append_n (&builder, base, base_size);
+    (void)string_builder_append_n (&builder, quote, quote_size);
 
-    return dest;
+    return string_builder_finish (&builder);
 }
 
 
@@ -246,4 +439,140 @@ int_to_string (int n)
 }
 
 
+char *
+string_read_line (FILE *fp, int delim, char **buffer, size_t *alloc)
+{
+    void *temp = NULL;
+    size_t count = 0;
+    int c;
+
+    if ((NULL == fp) || (NULL == buffer) || (NULL == alloc))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* reuse the callers buffer, growing it as required */
+    while (EOF != (c = getc (fp)))
+    {
+        if ((count + 1) >= *alloc)
+        {
+            size_t new_alloc = (0 == *alloc ? 128 : (*alloc * 2));
+            temp = realloc (*buffer, new_alloc);
+            if (NULL == temp)
+            {
+                errno = ENOMEM;
+                return NULL;
+            }
+            *buffer = temp; temp = NULL;
+            *alloc  = new_alloc;
+        }
+
+        if (delim == c) break;
+        (*buffer)[count++] = (char)c;
+    }
+
+    /* nothing was read, the stream is exhausted */
+    if ((EOF == c) && (0 == count)) return NULL;
+
+    (*buffer)[count] = '\0';
+    return *buffer;
+}
+
+
+char **
+string_split_words (char *src, size_t *length_out)
+{
+    /* splits src in place into words the way a shell would, honoring
+     * 'single' and "double" quotes, backslash escapes, and # comments.
+     * returns a NULL terminated array pointing into src, free only the 
+     * array */
+    char **words = NULL;
+    void *temp = NULL;
+    size_t count = 0, alloc = 0;
+    char *read = src, *write = src;
+    char quote = '\0';
+
+    if ((NULL == src) || (NULL == length_out))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    while (true)
+    {
+        /* skip to the start of the next word */
+        while ((' ' == *read) || ('\t' == *read) || ('\r' == *read)) read++;
+        if (('\0' == *read) || ('#' == *read)) break;
+
+        if ((count + 2) > alloc)
+        {
+            alloc = (0 == alloc ? 8 : (alloc * 2));
+            temp  = realloc (words, alloc * sizeof (char *));
+            if (NULL == temp)
+            {
+                free (words);
+                errno = ENOMEM;
+                return NULL;
+            }
+            words = temp; temp = NULL;
+        }
+
+        /* the word is compacted as quotes and escapes are dropped */
+        write = read;
+        words[count++] = write;
+        for (; '\0' != *read; read++)
+        {
+            if (('\0' == quote) && ((' ' == *read) || ('\t' == *read) 
+                                 || ('\r' == *read)))
+            {
+                read++;
+                break;
+            }
+
+            if (('\'' != quote) && ('\\' == *read) && ('\0' != read[1]))
+            {
+                *(write++) = *(++read);
+            }
+            else if (('\0' == quote) && (('\'' == *read) || ('"' == *read)))
+            {
+                quote = *read;
+            }
+            else if (quote == *read)
+            {
+                quote = '\0';
+            }
+            else
+            {
+                *(write++) = *read;
+            }
+        }
+
+        if ('\0' != quote)     /* unbalanced quote */
+        {
+            free (words);
+            errno = EINVAL;
+            return NULL;
+        }
+
+        /* write never passes the separator read stepped over */
+        *write = '\0';
+    }
+
+    if (NULL == words)
+    {
+        words = malloc (sizeof (char *));
+        if (NULL == words)
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    words[count] = NULL;
+    *length_out  = count;
+    return words;
+}
+
+
 /* end of file */
\ No newline at end of file
@@ -9,16 +9,46 @@ extern "C" {
 #endif
 /* code start */
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 
+/* a growable string, appended to in place. an append that cannot grow the
+ * buffer marks the builder failed, later appends do nothing and finish
+ * returns NULL, so a run of appends needs checking only once */
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t alloc;
+    bool failed;
+} string_builder_t;
+
+
+void string_builder_init (string_builder_t *builder);
+void string_builder_reset (string_builder_t *builder);
+void string_builder_free (string_builder_t *builder);
+int string_builder_reserve (string_builder_t *builder, size_t n);
+int string_builder_append (string_builder_t *builder, const char *src);
+int string_builder_append_n (string_builder_t *builder, const char *src, 
+                             size_t n);
+int string_builder_append_char (string_builder_t *builder, char c);
+int string_builder_append_escaped (string_builder_t *builder, 
+                                   const char *src, char quote);
+int string_builder_append_int (string_builder_t *builder, int n);
+char *string_builder_finish (string_builder_t *builder);
+
 char *string_clone (const char *src);
 char *substring_clone (const char *src, size_t n);
 char *string_join (char **array, size_t n, char *seperator);
 char **string_split (char *src, char *find, size_t *length_out);
+char **string_split_words (char *src, size_t *length_out);
 char *string_replace (char *src, char *find, char *replace);
 char *string_quote (char *base, char *quote);
+size_t string_escape (char *dest, size_t size, const char *src, char quote);
 char *int_to_string (int n);
+char *string_read_line (FILE *fp, int delim, char **buffer, size_t *alloc);
 
 
 /* code end */
@@ -0,0 +1,257 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "trace.h"
+
+#include <errno.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/* statements stepping at once, a cursor stays open while others run */
+#define TRACE_RUNNING_MAX 16
+
+typedef struct
+{
+    char sql[TRACE_SQL_MAX];
+    sqlite3_int64 nanoseconds;
+    sqlite3_int64 rows;
+    bool slow;
+} trace_entry_t;
+
+/* the ring of the command in progress */
+static struct
+{
+    bool enabled;
+    bool to_file;
+    char filename[FILENAME_MAX];
+    sqlite3_int64 slow_ns;
+    trace_entry_t ring[TRACE_RING_SIZE];
+    size_t head;
+    size_t count;
+    struct
+    {
+        sqlite3_stmt *stmt;
+        sqlite3_int64 begin_ns;
+        sqlite3_int64 rows;
+    } running[TRACE_RUNNING_MAX];
+} s_trace;
+
+
+static sqlite3_int64 now_ns (void);
+static size_t find_running (sqlite3_stmt *stmt);
+static void copy_sql (char *dest, sqlite3_stmt *stmt);
+static void log_entry (FILE *fp, const trace_entry_t *entry);
+
+
+void
+trace_begin (void)
+{
+    memset (&s_trace, 0, sizeof (s_trace));
+}
+
+
+int
+trace_enable (const char *filename, double slow_ms)
+{
+    if (NULL != filename)
+    {
+        if (strlen (filename) >= sizeof (s_trace.filename))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        strcpy (s_trace.filename, filename);
+        s_trace.to_file = true;
+    }
+
+    s_trace.slow_ns = (0.0 < slow_ms) ? (sqlite3_int64)(slow_ms * 1e6) : 0;
+    s_trace.enabled = true;
+    return 0;
+}
+
+
+bool
+trace_enabled (void)
+{
+    return s_trace.enabled;
+}
+
+
+unsigned
+trace_mask (void)
+{
+    if (!s_trace.enabled) return 0;
+    return SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW;
+}
+
+
+void
+trace_end (void)
+{
+    /* without a threshold, everything recorded is dumped at the end */
+    if (s_trace.enabled && (0 == s_trace.slow_ns) && (0 < s_trace.count))
+    {
+        (void)trace_dump ();
+    }
+
+    s_trace.enabled = false;
+}
+
+
+static sqlite3_int64
+now_ns (void)
+{
+    struct timespec ts;
+
+    (void)timespec_get (&ts, TIME_UTC);
+    return ((sqlite3_int64)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+
+static size_t
+find_running (sqlite3_stmt *stmt)
+{
+    /* the slot of stmt, or a free one for it. TRACE_RUNNING_MAX when
+     * neither is left, such statements go untimed and uncounted */
+    size_t free_slot = TRACE_RUNNING_MAX;
+
+    for (size_t i = 0; i < TRACE_RUNNING_MAX; i++)
+    {
+        if (stmt == s_trace.running[i].stmt) return i;
+        if ((NULL == s_trace.running[i].stmt)
+         && (TRACE_RUNNING_MAX == free_slot))
+        {
+            free_slot = i;
+        }
+    }
+
+    if (TRACE_RUNNING_MAX != free_slot)
+    {
+        s_trace.running[free_slot].stmt     = stmt;
+        s_trace.running[free_slot].begin_ns = 0;
+        s_trace.running[free_slot].rows     = 0;
+    }
+    return free_slot;
+}
+
+
+static void
+copy_sql (char *dest, sqlite3_stmt *stmt)
+{
+    /* the sql with its parameters bound, on one line */
+    char *expanded = sqlite3_expanded_sql (stmt);
+    const char *sql = (NULL != expanded) ? expanded : sqlite3_sql (stmt);
+    size_t n = 0;
+
+    if (NULL == sql) sql = "";
+    for (; ('\0' != sql[n]) && (n < TRACE_SQL_MAX - 1); n++)
+    {
+        dest[n] = (('\n' == sql[n]) || ('\t' == sql[n])) ? ' ' : sql[n];
+    }
+    dest[n] = '\0';
+
+    sqlite3_free (expanded);
+}
+
+
+void
+trace_record (unsigned type, void *p, void *x)
+{
+    trace_entry_t *entry = NULL;
+    size_t slot = 0;
+    sqlite3_int64 nanoseconds = 0, rows = 0;
+
+    if (!s_trace.enabled) return;
+
+    slot = find_running (p);
+    if (SQLITE_TRACE_STMT == type)
+    {
+        /* sqlite times statements in whole milliseconds on most systems,
+         * so the clock starts here instead. triggers report under the
+         * statement that fired them, after it started */
+        if ((TRACE_RUNNING_MAX != slot)
+         && (0 == s_trace.running[slot].begin_ns))
+        {
+            s_trace.running[slot].begin_ns = now_ns ();
+        }
+        return;
+    }
+    if (SQLITE_TRACE_ROW == type)
+    {
+        if (TRACE_RUNNING_MAX != slot) s_trace.running[slot].rows++;
+        return;
+    }
+    if (SQLITE_TRACE_PROFILE != type) return;
+
+    nanoseconds = *(sqlite3_int64 *)x;
+    if (TRACE_RUNNING_MAX != slot)
+    {
+        if (0 != s_trace.running[slot].begin_ns)
+        {
+            nanoseconds = now_ns () - s_trace.running[slot].begin_ns;
+        }
+        rows = s_trace.running[slot].rows;
+        s_trace.running[slot].stmt = NULL;
+    }
+
+    /* the oldest entry makes way once the ring is full */
+    entry = &s_trace.ring[s_trace.head];
+    s_trace.head = (s_trace.head + 1) % TRACE_RING_SIZE;
+    if (TRACE_RING_SIZE > s_trace.count) s_trace.count++;
+
+    copy_sql (entry->sql, p);
+    entry->nanoseconds = nanoseconds;
+    entry->rows = rows;
+    entry->slow = ((0 < s_trace.slow_ns) && (nanoseconds >= s_trace.slow_ns));
+
+    /* a slow statement dumps the ring, and the statements that led to it */
+    if (entry->slow) (void)trace_dump ();
+}
+
+
+static void
+log_entry (FILE *fp, const trace_entry_t *entry)
+{
+    fprintf (fp, "trace: %lld ns, %lld rows%s: %s\n",
+             (long long)entry->nanoseconds, (long long)entry->rows,
+             (entry->slow ? ", slow" : ""), entry->sql);
+}
+
+
+int
+trace_dump (void)
+{
+    FILE *fp = stderr;
+    size_t first = 0;
+
+    if (s_trace.to_file)
+    {
+        fp = fopen (s_trace.filename, "a");
+        if (NULL == fp)
+        {
+            fprintf (stderr, "error: cannot open trace file '%s'\n",
+                     s_trace.filename);
+            return -1;
+        }
+    }
+
+    first = (s_trace.head + TRACE_RING_SIZE - s_trace.count) % TRACE_RING_SIZE;
+    for (size_t i = 0; i < s_trace.count; i++)
+    {
+        log_entry (fp, &s_trace.ring[(first + i) % TRACE_RING_SIZE]);
+    }
+    s_trace.count = 0;
+
+    if (s_trace.to_file) fclose (fp);
+    else fflush (fp);
+
+    return 0;
+}
+
+
+/* end of file */
@@ -0,0 +1,44 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_TRACE_HEADER
+#define HEMLOCK_TRACE_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+
+/* the last statements a command ran are kept, and dumped oldest first */
+#define TRACE_RING_SIZE 64
+#define TRACE_SQL_MAX   1024
+
+
+/* one command runs between trace_begin () and trace_end (). once enabled,
+ * every statement is recorded with its expanded sql, run time and rows.
+ * with a slow_ms above 0, the ring is dumped whenever a statement takes
+ * longer, otherwise trace_end () dumps it. dumps are appended to filename,
+ * or written to stderr when it is NULL */
+void trace_begin (void);
+void trace_end (void);
+int trace_enable (const char *filename, double slow_ms);
+bool trace_enabled (void);
+
+/* the sqlite3_trace_v2 () events trace_record () wants, 0 while disabled */
+unsigned trace_mask (void);
+void trace_record (unsigned type, void *p, void *x);
+
+/* dumps and empties the ring, returns 0 on success */
+int trace_dump (void);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */
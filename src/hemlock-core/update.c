@@ -0,0 +1,468 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "update.h"
+
+#include "arena.h"
+#include "arguement.h"
+#include "config.h"
+#include "database.h"
+#include "database_core.h"
+#include "mode_template.h"
+#include "settings.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static int get_sequenced_args (settings_t *settings, int argc, char **argv);
+static int get_field_args (settings_t *settings, int argc, char **argv);
+static void log_update_help (FILE *fp);
+static db_package_t package_from_settings (db_package_t *current, 
+                                           settings_t settings);
+static int update_package (settings_t settings);
+
+
+int
+update_wrapper (int argc, char **argv)
+{
+    const required_t required = REQUIRE_NAME | REQUIRE_VERSION;
+    int retcode = 0;
+    settings_t settings;
+    
+    retcode = mode_template_proccess_args (&settings, argc, argv, required, 
+            get_sequenced_args, get_field_args, log_update_help);
+    if (0 != retcode) return ((0 < retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    retcode = update_package (settings);
+
+    return ((0 == retcode) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static db_package_t
+package_from_settings (db_package_t *current, settings_t settings)
+{
+    /* start from the stored row, and mark only the fields given on the
+     * command line */
+    db_package_t package = *current;
+
+    package.valid = PACKAGE_VALID_PACKAGE_ID;
+
+    if (NULL != settings.new_name)
+    {
+        package.name = settings.new_name;
+        package.valid |= PACKAGE_VALID_NAME;
+    }
+    if (NULL != settings.new_version)
+    {
+        package.version = settings.new_version;
+        package.valid |= PACKAGE_VALID_VERSION;
+    }
+    if (NULL != settings.homepage)
+    {
+        package.homepage = settings.homepage;
+        package.valid |= PACKAGE_VALID_HOMEPAGE;
+    }
+    if (NULL != settings.maintainer)
+    {
+        package.maintainer = settings.maintainer;
+        package.valid |= PACKAGE_VALID_MAINTAINER;
+    }
+    if (NULL != settings.email)
+    {
+        package.email = settings.email;
+        package.valid |= PACKAGE_VALID_EMAIL;
+    }
+    if (settings.as_dependency_given)
+    {
+        package.as_dependency = settings.as_dependency;
+        package.valid |= PACKAGE_VALID_AS_DEPENDENCY;
+    }
+    if (settings.is_installed_given)
+    {
+        package.is_installed = settings.is_installed;
+        package.valid |= PACKAGE_VALID_IS_INSTALLED;
+    }
+
+    return package;
+}
+
+
+static int
+update_package (settings_t settings)
+{
+    int retcode = -1;
+    int package_id = 0, other_id = 0;
+    uint32_t changed = PACKAGE_INVALID;
+    sqlite3 *db = NULL;
+    arena_t arena;
+    db_package_t *current = NULL;
+    db_package_t package;
+
+    arena_init (&arena);
+
+    db = db_open (settings.database);
+    if (NULL == db)
+    {
+        fprintf (stderr, "error: cannot open database at '%s'\n", 
+                 settings.database);
+        return -1;
+    }
+
+    if (0 != db_create_tables (db, NULL))
+    {
+        fprintf (stderr, "error: cannot create database tables\n");
+        goto update_package_exit;
+    }
+
+    if (settings.dry_run)
+    {
+        fprintf (stderr, "dry run detected\n"); 
+    }
+
+    if (0 != db_transaction_begin (db, NULL))
+    {
+        fprintf (stderr, "error: cannot begin transaction\n");
+        goto update_package_exit;
+    }
+
+    /* load the stored row, and keep only the fields that differ */
+    retcode = db_find_package (db, settings.name, settings.version, 
+                               &package_id, NULL);
+    if (1 == retcode)
+    {
+        fprintf (stderr, "error: package does not exist\n");
+        retcode = -1;
+    }
+    if (0 == retcode)
+    {
+        current = db_search_package_id (db, &arena, package_id, NULL);
+        if (NULL == current)
+        {
+            fprintf (stderr, "error: cannot read package\n");
+            retcode = -1;
+        }
+    }
+    if (0 == retcode)
+    {
+        package = package_from_settings (current, settings);
+        changed = db_package_diff (current, &package);
+    }
+
+    /* a rename must not collide with another package */
+    if ((0 == retcode) 
+     && (changed & (PACKAGE_VALID_NAME | PACKAGE_VALID_VERSION)))
+    {
+        retcode = db_find_package (db, package.name, package.version, 
+                                   &other_id, NULL);
+        if (0 == retcode)
+        {
+            fprintf (stderr, "error: package exists\n");
+            retcode = -1;
+        }
+        else if (1 == retcode)
+        {
+            retcode = 0;
+        }
+    }
+
+    if ((0 == retcode) && (PACKAGE_INVALID != changed) && (!settings.dry_run))
+    {
+        retcode = db_update_package (db, &package, NULL);
+        if (0 != retcode)
+        {
+            fprintf (stderr, "error: cannot update package\n");
+        }
+    }
+
+    /* with nothing changed the transaction commits without a write */
+    if ((0 == retcode) && (!settings.dry_run))
+    {
+        retcode = db_transaction_commit (db, NULL);
+    }
+    else
+    {
+        (void)db_transaction_rollback (db, NULL);
+    }
+
+    if ((0 == retcode) && (settings.verbose))
+    {
+        if (PACKAGE_INVALID == changed)
+        {
+            fprintf (stderr, "package unchanged\n");
+        }
+        else
+        {
+            char *readable = db_human_readable_package (&package);
+            fprintf (stderr, "%s\n", (NULL != readable ? readable : "?"));
+            free (readable); readable = NULL;
+        }
+    }
+
+update_package_exit:
+    db_close (db); db = NULL;
+    arena_free (&arena);
+
+    return retcode;
+}
+
+
+static int
+get_sequenced_args (settings_t *settings, int argc, char **argv)
+{   
+    int initial_count = argc;
+    char *name    = NULL;
+    char *version = NULL;
+
+    /* update [NAME [VERSION]] */
+
+    /* name (optional) */
+    name = conarg_get_param (argc, argv);
+    if ((NULL == name) || (conarg_is_flag (name))) 
+    {
+        name = NULL;
+        goto sequence_exit;
+    }
+    CONARG_STEP (argc, argv);
+
+    /* version (optional) */
+    version = conarg_get_param (argc, argv);
+    if ((NULL == version) || (conarg_is_flag (version))) 
+    {
+        version = NULL;
+        goto sequence_exit;
+    }
+    CONARG_STEP (argc, argv);
+
+sequence_exit:
+    settings->name    = name;
+    settings->version = version;
+
+    return (initial_count - argc);
+}
+
+
+static int
+get_field_args (settings_t *settings, int argc, char **argv)
+{
+    int initial_count = argc;
+
+    enum 
+    {
+        UPDATE_NAME = CONARG_ID_CUSTOM,
+        UPDATE_VERSION,
+        UPDATE_HOMEPAGE,
+        UPDATE_MAINTAINER,
+        UPDATE_EMAIL,
+        UPDATE_DEPENDENCY,
+        UPDATE_STANDALONE,
+        UPDATE_INSTALLED,
+        UPDATE_UNINSTALLED,
+        UPDATE_DRY,
+        UPDATE_DATABASE,
+        UPDATE_PROFILE,
+        UPDATE_DEBUG,
+        UPDATE_STATS,
+        UPDATE_TRACE,
+        UPDATE_SLOW_QUERY,
+        UPDATE_VERBOSE,
+        UPDATE_TERSE,
+        UPDATE_HELP,
+    };
+
+    const conarg_t ARG_LIST[] = 
+    {
+        { UPDATE_NAME,        "-n", "--name",        CONARG_PARAM_REQUIRED },
+        { UPDATE_VERSION,     "-V", "--version",     CONARG_PARAM_REQUIRED },
+        { UPDATE_HOMEPAGE,    "-p", "--homepage",    CONARG_PARAM_REQUIRED },
+        { UPDATE_MAINTAINER,  "-m", "--maintainer",  CONARG_PARAM_REQUIRED },
+        { UPDATE_EMAIL,       "-e", "--email",       CONARG_PARAM_REQUIRED },
+        { UPDATE_DEPENDENCY,  "-d", "--dependency",  CONARG_PARAM_NONE },
+        { UPDATE_STANDALONE,  "-D", "--standalone",  CONARG_PARAM_NONE },
+        { UPDATE_INSTALLED,   "-i", "--installed",   CONARG_PARAM_NONE },
+        { UPDATE_UNINSTALLED, "-I", "--uninstalled", CONARG_PARAM_NONE },
+
+        { UPDATE_DRY,      NULL, "--dryrun",   CONARG_PARAM_NONE },
+        { UPDATE_DATABASE, NULL, "--database", CONARG_PARAM_REQUIRED },
+        { UPDATE_PROFILE,  NULL, "--profile",  CONARG_PARAM_REQUIRED },
+
+        { UPDATE_DEBUG,   NULL, "--debug",   CONARG_PARAM_NONE },
+        { UPDATE_STATS,   NULL, "--stats",   CONARG_PARAM_NONE },
+        { UPDATE_TRACE,   NULL, "--trace",   CONARG_PARAM_REQUIRED },
+        { UPDATE_SLOW_QUERY, NULL, "--slow-query", CONARG_PARAM_REQUIRED },
+        { UPDATE_VERBOSE, "-v", "--verbose", CONARG_PARAM_NONE },
+        { UPDATE_TERSE,   "-t", "--terse",   CONARG_PARAM_NONE },
+        { UPDATE_HELP,    "-h", "--help",    CONARG_PARAM_NONE },
+    };
+    const size_t ARG_COUNT = sizeof (ARG_LIST) / sizeof (*ARG_LIST);
+    
+    int id;
+    conarg_status_t param_stat;
+
+    while (argc > 0)
+    {
+        param_stat = CONARG_STATUS_NA;
+        id = conarg_check (ARG_LIST, ARG_COUNT, argc, argv, &param_stat);
+
+        switch (id)
+        {
+        case UPDATE_NAME:
+            CONARG_STEP (argc, argv);
+            settings->new_name = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_VERSION:
+            CONARG_STEP (argc, argv);
+            settings->new_version = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_HOMEPAGE:
+            CONARG_STEP (argc, argv);
+            settings->homepage = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_MAINTAINER:
+            CONARG_STEP (argc, argv);
+            settings->maintainer = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_EMAIL:
+            CONARG_STEP (argc, argv);
+            settings->email = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_DEPENDENCY:
+            settings->as_dependency = true;
+            settings->as_dependency_given = true;
+            break;
+
+        case UPDATE_STANDALONE:
+            settings->as_dependency = false;
+            settings->as_dependency_given = true;
+            break;
+
+        case UPDATE_INSTALLED:
+            settings->is_installed = true;
+            settings->is_installed_given = true;
+            break;
+
+        case UPDATE_UNINSTALLED:
+            settings->is_installed = false;
+            settings->is_installed_given = true;
+            break;
+
+        case UPDATE_DATABASE:
+            CONARG_STEP (argc, argv);
+            settings->database = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_DRY:
+            settings->dry_run = true;
+            break;
+
+        case UPDATE_PROFILE:
+            CONARG_STEP (argc, argv);
+            settings->profile = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_STATS:
+            settings->stats = true;
+            break;
+
+        case UPDATE_TRACE:
+            CONARG_STEP (argc, argv);
+            settings->trace_file = conarg_get_param (argc, argv);
+            break;
+
+        case UPDATE_SLOW_QUERY:
+            CONARG_STEP (argc, argv);
+            if (0 != settings_set_slow_query (settings, 
+                                              conarg_get_param (argc, argv)))
+            {
+                return MODE_ARGS_ERROR;
+            }
+            break;
+
+        case UPDATE_DEBUG:
+            settings->debug   = true;
+            /* enable all verbose flags too */
+            /* fall through */
+        case UPDATE_VERBOSE:
+            settings->verbose = true;
+            break;
+
+        case UPDATE_TERSE:
+            settings->verbose = false;
+            break;
+
+        case UPDATE_HELP:
+            log_update_help (stdout);
+            return MODE_ARGS_HELP;
+
+        /* error states */
+        case CONARG_ID_UNKNOWN:
+        case CONARG_ID_PARAM_ERROR:
+        default:
+            log_update_help (stderr);
+            return MODE_ARGS_ERROR;
+        }
+
+        CONARG_STEP (argc, argv);
+    }
+
+    return (initial_count - argc);
+}
+
+
+static void
+log_update_help (FILE *fp)
+{
+    const char *HELP_MESSAGE = {
+        "Usage: " PROJECT_NAME " update NAME VERSION [OPTION]...\n"
+        "Change the fields of a package in the package database.\n"
+        "Egless otherwise specified assume -t flag,\n"
+        "\n"
+        "Mandatory arguements to long options are mandatory for short options too.\n"
+        "  -n, --name NAME             rename the package to NAME\n"
+        "  -V, --version VERSION       change the package version to VERSION\n"
+        "  -p, --homepage URL          set the package homepage to URL\n"
+        "  -m, --maintainer NAME       set the package maintainer to NAME\n"
+        "  -e, --email EMAIL           set the maintainer contact email to EMAIL\n"
+        "  -d, --dependency            mark the package as a dependency\n"
+        "  -D, --standalone            mark the package as not a dependency\n"
+        "  -i, --installed             mark the package as installed\n"
+        "  -I, --uninstalled           mark the package as not installed\n"
+        "      --database DBFILE       override the package database file, use DBFILE\n"
+        "      --dryrun                preform a dry-run. dont preform any writes\n"
+        "      --profile NAME          tune the database connection: safe, fast, bulk\n"
+        "      --debug                 log all (often unnecessary) information\n"
+        "      --stats                 report where the time went, on stderr\n"
+        "      --trace FILE            append every statement and its time to FILE\n"
+        "      --slow-query MS         dump recent statements if one runs over MS ms\n"
+        "  -v, --verbose               log extra information\n"
+        "  -t, --terse                 only log errors\n"
+        "  -h, --help                  show this message\n"
+        "\n"
+        "The NAME and VERSION arguements are required, and must match the package\n"
+        "exactly. Only the fields given, and that differ from the stored package, are\n"
+        "written. If nothing differs the database is not written at all.\n"
+        "\n"
+        "The DBFILE arguement is expected to be a SQLite3 database, and is expected to\n"
+        "exist, if it does not, it will be created.\n"
+        "\n"
+        "Exit status:\n"
+        " 0  if OK,\n"
+        " 1  if error.\n"
+        "\n"
+        "SoftFauna hemlock: <https://github.com/SoftFauna/hemlock/>\n"
+        "\n"
+    };
+
+    fprintf (fp, HELP_MESSAGE);
+    fflush (fp);
+}
+
+
+/* end of file */
@@ -0,0 +1,170 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#include "version.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* every token of a key starts with a marker, ordered so that a pre-release
+ * sorts before the end of a version, and the end before any further
+ * letters or numbers */
+#define KEY_PRE_RELEASE '!'
+#define KEY_END         '#'
+#define KEY_ALPHA       '$'
+#define KEY_NUMERIC     '%'
+
+/* a numeric token's length is one character, 'A' for one digit */
+#define KEY_LENGTH_BASE 'A'
+#define KEY_LENGTH_MAX  ('z' - KEY_LENGTH_BASE + 1)
+
+/* pre-release words, least mature first */
+static const char *PRE_RELEASE[] = { "dev", "alpha", "beta", "pre", "rc" };
+#define PRE_RELEASE_COUNT (sizeof (PRE_RELEASE) / sizeof (*PRE_RELEASE))
+
+
+static int pre_release_rank (const char *word, size_t length);
+static void sql_version_key (sqlite3_context *context, int argc, 
+                             sqlite3_value **argv);
+
+
+static int
+pre_release_rank (const char *word, size_t length)
+{
+    /* returns the rank of a pre-release word, or -1 for any other word */
+    for (size_t i = 0; i < PRE_RELEASE_COUNT; i++)
+    {
+        if ((length == strlen (PRE_RELEASE[i]))
+         && (0 == sqlite3_strnicmp (word, PRE_RELEASE[i], (int)length)))
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+
+char *
+version_key (const char *version)
+{
+    /* digits and letters form tokens, anything else seperates them. a
+     * numeric token is its length then its digits, less leading zeros, so
+     * longer numbers sort later. letters are lowercased, and '~' or a
+     * pre-release word sorts before the plain release */
+    char *key = NULL, *iter = NULL;
+    const char *c = NULL, *start = NULL;
+    size_t length = 0;
+    int rank;
+
+    if (NULL == version)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* a token grows by at most two marker characters, and is never
+     * shorter than them */
+    key = malloc ((strlen (version) * 3) + 2);
+    if (NULL == key)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    iter = key;
+    for (c = version; '\0' != *c; )
+    {
+        if (isdigit ((unsigned char)*c))
+        {
+            while ('0' == *c) c++;
+            for (start = c; isdigit ((unsigned char)*c); c++) {}
+
+            /* all zeros is still the number 0 */
+            if (start == c) start--;
+            length = (size_t)(c - start);
+
+            *(iter++) = KEY_NUMERIC;
+            *(iter++) = (char)(KEY_LENGTH_BASE 
+                             + ((length < KEY_LENGTH_MAX) ? length 
+                                                          : KEY_LENGTH_MAX) 
+                             - 1);
+            memcpy (iter, start, length);
+            iter += length;
+        }
+        else if (isalpha ((unsigned char)*c))
+        {
+            for (start = c; isalpha ((unsigned char)*c); c++) {}
+            length = (size_t)(c - start);
+
+            rank = pre_release_rank (start, length);
+            if (0 <= rank)
+            {
+                *(iter++) = KEY_PRE_RELEASE;
+                *(iter++) = (char)('a' + rank);
+                continue;
+            }
+
+            *(iter++) = KEY_ALPHA;
+            for (size_t i = 0; i < length; i++)
+            {
+                *(iter++) = (char)tolower ((unsigned char)start[i]);
+            }
+        }
+        else
+        {
+            if ('~' == *c) *(iter++) = KEY_PRE_RELEASE;
+            c++;
+        }
+    }
+    *(iter++) = KEY_END;
+    *iter = '\0';
+
+    return key;
+}
+
+
+static void
+sql_version_key (sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    const unsigned char *version = NULL;
+    char *key = NULL;
+
+    (void)argc;
+
+    version = sqlite3_value_text (argv[0]);
+    if (NULL == version)
+    {
+        sqlite3_result_null (context);
+        return;
+    }
+
+    key = version_key ((const char *)version);
+    if (NULL == key)
+    {
+        sqlite3_result_error_nomem (context);
+        return;
+    }
+
+    sqlite3_result_text (context, key, -1, free);
+}
+
+
+int
+version_register (sqlite3 *db)
+{
+    /* hemlock_version_key (VERSION) for the schema and its queries */
+    int retcode = sqlite3_create_function (db, "hemlock_version_key", 1, 
+            SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, sql_version_key, 
+            NULL, NULL);
+
+    return ((SQLITE_OK == retcode) ? 0 : -1);
+}
+
+
+/* end of file */
@@ -0,0 +1,26 @@
+/* HEMLOCK - a system independent package manager. */
+/* <https://github.com/SoftFauna/HEMLOCK.git> */
+/* Copyright (c) 2024 The SoftFauna Team */
+
+#ifndef HEMLOCK_VERSION_HEADER
+#define HEMLOCK_VERSION_HEADER
+#ifdef __cplusplus  /* C++ compatibility */
+extern "C" {
+#endif
+/* code start */
+
+#include <sqlite3.h>
+
+
+/* sort keys for version strings. two keys compare with strcmp (or SQLite's
+ * BINARY collation) in the order of their versions, so "1.9" < "1.10",
+ * "1.0rc1" < "1.0" < "1.0a" < "1.0.1" */
+char *version_key (const char *version);
+int version_register (sqlite3 *db);
+
+/* code end */
+#ifdef __cplusplus  /* C++ compatibility */
+}
+#endif
+#endif /* header guard */
+/* end of file */